@@ -45,6 +45,12 @@
 #include <getopt.h>
 #endif
 
+#include "glyphs.h"
+#include "mtx.h"
+#include "perf.h"
+#include "render.h"
+#include "shared.h"
+
 extern char *optarg;
 extern int optind, opterr, optopt;
 
@@ -82,46 +88,45 @@ int setenv(const char *name, const char *value, int overwrite);
 #define TIOCSTI 0x5412
 #endif
 
-#define MTX_FLAG_BOLD      0x00000003
-#define MTX_FLAG_BOLD_SOME 0x00000001
-#define MTX_FLAG_BOLD_ALL  0x00000002
-#define MTX_FLAG_BOLD_NONE 0x00000003
-
-#define MTX_FLAG_SCRSAVE   0x00000004
-#define MTX_FLAG_ASYNC     0x00000008
-#define MTX_FLAG_FORCE     0x00000010
-#define MTX_FLAG_LOCK      0x00000020
-#define MTX_FLAG_MSG       0x00000040
-#define MTX_FLAG_PREALLOC  0x00000080
-#define MTX_FLAG_RAINBOW   0x00000100
-#define MTX_FLAG_LAMBDA    0x00000200
-#define MTX_FLAG_CHANGES   0x00000400
-#define MTX_FLAG_PAUSE     0x00000800
-#define MTX_FLAG_LINUX     0x00001000
-#define MTX_FLAG_XWINDOW   0x00002000
-#define MTX_FLAG_UNICODE   0x00004000
-#define MTX_FLAG_OLD       0x00008000
-
-#define MTX_FLAG_FIRSTCOL  0x80000000
-#define MTX_FLAG_CONCURCOL 0x80000000
-
-#define MTX_BLANK  -1
-#define MTX_HEAD   -2
-
 #define NUM_COLORS 7
 
 /* Global variables */
 uint32_t flags = MTX_FLAG_ASYNC;
 
-int **matrix = NULL;
-int *length = NULL;  /* Length of cols in each line */
-int *spaces = NULL;  /* Spaces left to fill */
-int *updates = NULL; /* Determines frequency of updates on each line (-a) */
+int nlayers = 1;                  /* --layers. */
+int subcell = 0;                  /* --subcell, MTX_SUB_BRAILLE or MTX_SUB_HALF. */
+int warmup = 0;                   /* --warmup, frames to run before the first one. */
+int redraw = 1;                   /* draw every cell of every display next frame. */
+char *msg = NULL;                 /* -M or -L. */
+
+/* a terminal to draw on. displays of the same size share a simulation. */
+#define MAX_DISPLAYS 64
+struct display
+{
+	char *tty;                    /* NULL for the one we were started on. */
+	FILE *file;
+	SCREEN *screen;
+	struct mtx_layers *mtx;       /* the simulation, see mtx.h. */
+	struct mtx_change *heads;     /* heads on screen, they get a new char every frame. */
+	size_t nheads;
+	int redraw;                   /* draw every cell instead of just the changed ones. */
+	int msg_x, msg_y, msg_len;    /* -M or -L box. */
+	struct mtx_sub *sub;          /* --subcell dots. */
+	struct shared *shm;           /* --shared, for the first display of a simulation. */
+	struct shared_key key;
+	int fresh;                    /* the simulation has a new frame. */
+};
+struct display displays[MAX_DISPLAYS];
+int ndisplays = 0;
+
+int color_vals[NUM_COLORS] = {COLOR_GREEN, COLOR_RED, COLOR_BLUE, COLOR_YELLOW, COLOR_CYAN, COLOR_MAGENTA, COLOR_WHITE};
+int mcolor = COLOR_GREEN;
 
 #define RAND_LEN_MIN 512
 #define RAND_LEN_MAX 8192
 uint32_t rand_len = 1024; /* length of prealloc values. can be changed by arg. */
 int *rand_array = NULL; /* preallocated rand values. */
+uint32_t rand_filled = 0; /* how much of rand_array has been filled in so far. */
 int randmin = 33, randmax=123; /* min is inclusive, max is exclusive. */
 
 /* unicode chars. */
@@ -136,12 +141,108 @@ char *chars_array[CHARS_LEN] =
 	"ﾀ", "ﾇ", "ﾍ", "0", "1", "2",
 	"3", "4", "5", "6", "7", "8",
 	"9", "Z"};
+
+/* --glyphs, cell values 1 to count index into it. */
+struct glyphset glyphs;
 #endif
 
 #ifndef _WIN32
 volatile sig_atomic_t signal_status = 0; /* Indicates a caught signal */
 #endif
 
+/* timing for --stats, in seconds. */
+double start_time = 0;     /* when main() was entered. */
+double first_frame = 0;    /* when the first frame was on screen. */
+double busy_time = 0;      /* spent simulating and drawing, not sleeping. */
+unsigned long frames = 0;
+unsigned long sim_frames = 0; /* frames simulated here, not shown from --shared. */
+int use_shared = 0;           /* --shared. */
+int shared_errno = 0;         /* why --shared couldn't be used. */
+
+/* --perf counters, for what a frame spends where. */
+#define PHASE_SIMULATE 0          /* stepping the simulations. */
+#define PHASE_DRAW     1          /* drawing into curses. */
+#define PHASE_REFRESH  2          /* curses working out and writing what changed, and input. */
+struct perf perf;
+int use_perf = 0;
+int perf_errno = 0;
+
+/* --cpu-budget: when frames cost more than the budget, quality goes */
+/* down a level at a time, and back up once there's room again. */
+#define QUALITY_NO_CHANGES 1      /* -k is off. */
+#define QUALITY_NO_REROLL  2      /* heads keep their char. */
+#define QUALITY_SPARSE     3      /* fewer streams start. */
+#define QUALITY_SLOW       4      /* half the frame rate. */
+#define QUALITY_LEVELS     5
+double budget = 0;            /* seconds a frame, or a share of the time with budget_share. */
+int budget_share = 0;
+double budget_load = 0;       /* recent frames' cost, 1 is all of the budget. */
+int quality = 0;              /* levels down from full quality. */
+int quality_hold = 0;         /* frames since it last changed. */
+int quality_changes = 0;
+unsigned long quality_frames[QUALITY_LEVELS];
+
+/* weigh a frame that was busy for busy seconds out of interval. */
+void govern(double busy, double interval)
+{
+	double limit = budget_share ? budget * interval : budget;
+
+	if(limit <= 0)
+		return;
+	budget_load += (busy / limit - budget_load) / 16;
+	quality_frames[quality]++;
+	quality_hold++;
+
+	/* down quickly, up slowly, and not up until the frames */
+	/* cost half the budget, so it doesn't go back and forth. */
+	if(budget_load > 1 && quality_hold >= 16 && quality < QUALITY_LEVELS - 1)
+	{
+		quality++;
+		quality_hold = 0;
+		quality_changes++;
+	}
+	else if(budget_load < 0.5 && quality_hold >= 128 && quality > 0)
+	{
+		quality--;
+		quality_hold = 0;
+		quality_changes++;
+	}
+}
+
+void print_stats(void)
+{
+	double elapsed = now() - start_time;
+	int i;
+
+	if(!(flags & MTX_FLAG_STATS) || !frames)
+		return;
+	fprintf(stderr, "startup:        %.3f ms to first frame\n", (first_frame - start_time) * 1e3);
+	fprintf(stderr, "frames:         %lu in %.3f s (%.1f frames/s)\n", frames, elapsed, frames / elapsed);
+	fprintf(stderr, "frame time:     %.1f us (simulation and drawing)\n", busy_time * 1e6 / frames);
+	if(use_shared)
+		fprintf(stderr, "simulated:      %lu frames here, the rest from --shared\n", sim_frames);
+	if(budget > 0)
+	{
+		fprintf(stderr, "quality:        level %d of %d at exit, changed %d times, frames at each:",
+		        quality, QUALITY_LEVELS - 1, quality_changes);
+		for(i=0; i<QUALITY_LEVELS; i++)
+			fprintf(stderr, " %lu", quality_frames[i]);
+		fprintf(stderr, "\n");
+	}
+	if(use_perf)
+	{
+		fprintf(stderr, "counted:        per frame%s\n", perf.kernel ? "" : ", user space only");
+		for(i=PHASE_SIMULATE; i<=PHASE_REFRESH; i++)
+		{
+			fprintf(stderr, "  %-13s %.0f cycles, %.0f instructions, %.0f cache misses\n",
+			        i == PHASE_SIMULATE ? "simulate:" : i == PHASE_DRAW ? "draw:" : "refresh:",
+			        (double) perf.total[i][PERF_CYCLES] / frames,
+			        (double) perf.total[i][PERF_INSTRUCTIONS] / frames,
+			        (double) perf.total[i][PERF_CACHE_MISSES] / frames);
+		}
+	}
+}
+
 int va_system(char *str, ...)
 {
 	va_list ap;
@@ -153,14 +254,34 @@ int va_system(char *str, ...)
 	return system(buf);
 }
 
+/* put every terminal back the way it was. */
+void end_displays(void)
+{
+	int i;
+
+	for(i=0; i<ndisplays; i++)
+	{
+		shared_close(displays[i].shm);
+		displays[i].shm = NULL;
+		if(displays[i].screen == NULL)
+			continue;
+		set_term(displays[i].screen);
+		curs_set(1);
+		clear();
+		refresh();
+		resetty();
+		endwin();
+	}
+}
+
 /* What we do when we're all set to exit */
 void finish(void)
 {
-	curs_set(1);
-	clear();
-	refresh();
-	resetty();
-	endwin();
+	end_displays();
+	if(shared_errno)
+		fprintf(stderr, "cmatrix: --shared couldn't be used: %s\n", strerror(shared_errno));
+	if(perf_errno)
+		fprintf(stderr, "cmatrix: --perf couldn't count: %s\n", strerror(perf_errno));
 #ifdef HAVE_CONSOLECHARS
 	if(flags & MTX_FLAG_LINUX)
 		va_system("consolechars -d");
@@ -168,6 +289,7 @@ void finish(void)
 	if(flags & MTX_FLAG_LINUX)
 		va_system("setfont");
 #endif
+	print_stats();
 	exit(0);
 }
 
@@ -176,11 +298,7 @@ void c_die(char *msg, ...)
 {
 	va_list ap;
 
-	curs_set(1);
-	clear();
-	refresh();
-	resetty();
-	endwin();
+	end_displays();
 #ifdef HAVE_CONSOLECHARS
 	if(flags & MTX_FLAG_LINUX)
 		va_system("consolechars -d");
@@ -197,7 +315,7 @@ void c_die(char *msg, ...)
 }
 
 char usage[] =
-	" Usage: cmatrix -[aAbBcfhklLmnopsVx] [-C color] [-M message] [-P count] [-t tty] [-u delay]\n"
+	" Usage: cmatrix -[aAbBcfhklLmnopsVx] [-C color] [-M message] [-P count] [-t tty[,tty]...] [-u delay]\n"
 	" -a: Enable asynchronous scroll (default).\n"
 	" -A: Disable asynchronous scroll.\n"
 	" -b: Bold characters on.\n"
@@ -221,15 +339,79 @@ char usage[] =
 	" -P [count]: Specify number of rand values to prealloc. (Implies -p.)\n"
 	" -r: Rainbow mode.\n"
 	" -s: Screensaver mode, exits on first keystroke.\n"
-	" -t [tty]: Set tty to use.\n"
+	" -t [tty]: Set tty to use. Can be a list or given again to use several at once.\n"
 	" -u [delay]: Screen update delay (0 - 10, default 4).\n"
 	" -V: Print version information and exit.\n"
 	" -x: XTerm mode (for use with mtx.pcf).\n"
+	" --no-intro: Start -p without the \"Knock, knock, Neo.\" intro.\n"
+	" --stats: Print startup and frame timing on exit.\n"
+	" --render-video [file]: Render to a .y4m file (- for stdout) or to ppm frames\n"
+	"     named by a pattern like frame%04d.ppm, instead of the terminal.\n"
+	" --video-size [COLSxLINES]: Size of the video in cells (default 80x24).\n"
+	" --video-frames [count]: Number of frames to render (default 300).\n"
+	" --font [file]: PSF font for the video (default matrix.psf.gz).\n"
+	" --threads [count]: Threads to draw the video with (default one per cpu).\n"
+#ifdef HAVE_NCURSESW_NCURSES_H
+	" --glyphs [file]: Use a glyph set made with mtxglyph (overrides -c, -l and -x).\n"
+#endif
+	" --layers [count]: Rain in 1 to 8 layers, each one further back slower,\n"
+	"     sparser and dimmer (default 1).\n"
+	" --shared: Share the simulation with other cmatrix --shared processes\n"
+	"     of yours showing the same size and mode.\n"
+#ifdef HAVE_NCURSESW_NCURSES_H
+	" --subcell [braille|half]: Rain of dots, 2x4 (braille) or 1x2 (half blocks)\n"
+	"     to a cell.\n"
+#endif
+	" --cpu-budget [N%|Nus]: Time a frame may take, as a share of the time\n"
+	"     or in microseconds. Quality goes down to stay within it.\n"
+	" --warmup [frames]: Run this many frames before the first one and after\n"
+	"     a resize, so the screen starts full of rain (try 3 times the lines).\n"
+	" --perf: Count cycles, instructions and cache misses of each part of a\n"
+	"     frame, printed on exit (implies --stats).\n"
 #ifndef HAVE_NCURSESW_NCURSES_H
 	" Ignored for compatibility with disabled features: -c -m\n"
 #endif
 	; /* annoying, but i don't see a way around it, as the last line is inconsistent. */
 
+char shortopts[] = "aAbBcfhklLnrosmpxVM:u:C:t:P:";
+
+/* long-only options, numbered past any char. */
+#define OPT_NO_INTRO 256
+#define OPT_STATS    257
+#define OPT_RENDER_VIDEO 258
+#define OPT_VIDEO_SIZE   259
+#define OPT_VIDEO_FRAMES 260
+#define OPT_FONT         261
+#define OPT_THREADS      262
+#define OPT_GLYPHS       263
+#define OPT_LAYERS       264
+#define OPT_SHARED       265
+#define OPT_SUBCELL      266
+#define OPT_CPU_BUDGET   267
+#define OPT_WARMUP       268
+#define OPT_PERF         269
+
+#ifdef HAVE_GETOPT_H
+struct option longopts[] =
+{
+	{"no-intro", no_argument, NULL, OPT_NO_INTRO},
+	{"stats",    no_argument, NULL, OPT_STATS},
+	{"render-video", required_argument, NULL, OPT_RENDER_VIDEO},
+	{"video-size",   required_argument, NULL, OPT_VIDEO_SIZE},
+	{"video-frames", required_argument, NULL, OPT_VIDEO_FRAMES},
+	{"font",         required_argument, NULL, OPT_FONT},
+	{"threads",      required_argument, NULL, OPT_THREADS},
+	{"glyphs",       required_argument, NULL, OPT_GLYPHS},
+	{"layers",       required_argument, NULL, OPT_LAYERS},
+	{"shared",       no_argument,       NULL, OPT_SHARED},
+	{"subcell",      required_argument, NULL, OPT_SUBCELL},
+	{"cpu-budget",   required_argument, NULL, OPT_CPU_BUDGET},
+	{"warmup",       required_argument, NULL, OPT_WARMUP},
+	{"perf",         no_argument,       NULL, OPT_PERF},
+	{NULL, 0, NULL, 0}
+};
+#endif
+
 char version[] =
 	" CMatrix version " VERSION " (compiled " __TIME__ ", " __DATE__ ")\n"
 	" Copyright (C) 2025-2026       Xylia Allegretta\n"
@@ -246,11 +428,14 @@ void *nmalloc(size_t howmuch) {
 }
 
 /* Pre-allocate an array to read from, to reduce ongoing CPU-utilization on older systems */
+/* it fills itself the first time around, so there's no wait before the first frame. */
 int rand_pre()
 {
 	static int index = 0;
 	int next;
 
+	if(index == rand_filled)
+		rand_array[rand_filled++] = rand();
 	next = rand_array[index];
 	index++;
 	index%=rand_len;
@@ -262,104 +447,124 @@ int rand_pre()
 int (*rand_func)(void) = &rand;
 
 /* If we're pre-allocating a string of random ints to save
-   energy, do it here. Add a fun screen message while we do it */
+   energy, do it here. Add a fun screen message unless told not to */
 void rand_pre_init()
 {
-	int i, nextchar = 0, segment_size;
+	struct display *d;
+	size_t i;
 	char *funstring = "Knock, knock, Neo.";
 
 	/* change pointer! */
 	rand_func = &rand_pre;
 
-	/* bold green text. */
-	attron(COLOR_PAIR(COLOR_GREEN));
-	attron(A_BOLD);
-
 	/* not very necessary, as this function is only called once. */
 	if(rand_array != NULL)
 		free(rand_array);
 
 	/* allocate array. */
 	rand_array = nmalloc(sizeof(int) * (rand_len+1));
+	rand_filled = 0;
 
-	/* print first char. */
-	mvaddch(0, 0, funstring[0]);
-	nextchar++;
-
-	/* print chars of string as chunks are given random numbers. */
-	segment_size = rand_len / strlen(funstring) - 2;
-	for(i=0; i<=rand_len; i++)
+	/* the simulations draw from the table from now on. */
+	for(d=displays; d<displays+ndisplays; d++)
 	{
-	 	rand_array[i] = rand();
+		for(i=0; i<d->mtx->n; i++)
+			d->mtx->layer[i]->rand = rand_func;
+	}
 
-		if(i/segment_size > nextchar && nextchar<strlen(funstring))
+	if(flags & MTX_FLAG_NOINTRO)
+		return;
+
+	/* print the string one char at a time, in bold green, on every display. */
+	for(i=0; i<=strlen(funstring); i++)
+	{
+		for(d=displays; d<displays+ndisplays; d++)
 		{
-			addch(funstring[nextchar]);
+			set_term(d->screen);
+			if(funstring[i])
+			{
+				attron(COLOR_PAIR(COLOR_GREEN));
+				attron(A_BOLD);
+				mvaddch(0, i, funstring[i]);
+				attroff(COLOR_PAIR(COLOR_GREEN));
+				attroff(A_BOLD);
+			}
 			refresh();
-			nextchar++;
-			napms(180);
 		}
+		napms(180);
 	}
 
-	/* return screen to normal. */
-	attroff(COLOR_PAIR(COLOR_GREEN));
-	attroff(A_BOLD);
-	erase();
+	/* return screens to normal. */
+	for(d=displays; d<displays+ndisplays; d++)
+	{
+		set_term(d->screen);
+		erase();
+	}
 }
 
-/* Initialize the global variables */
-void var_init()
+/* the simulation of another display, if there's one of this size. */
+struct mtx_layers *shared_mtx(struct display *d, int cols, int lines)
 {
 	int i;
 
-	if(matrix != NULL)
+	for(i=0; i<ndisplays; i++)
 	{
-		free(matrix[0]);
-		free(matrix);
+		if(&displays[i] != d && displays[i].mtx &&
+		   displays[i].mtx->cols == cols && displays[i].mtx->lines == lines)
+			return displays[i].mtx;
 	}
+	return NULL;
+}
 
-	/* 2d char field. */
-	matrix = nmalloc(sizeof(int*) * LINES);
-	matrix[0] = nmalloc(sizeof(int) * LINES * COLS);
-	for(i=1; i<LINES; i++)
-		matrix[i] = matrix[i - 1] + COLS;
-
-	/* lengths of cols. */
-	if(length != NULL)
-		free(length);
-	length = nmalloc(COLS * sizeof(int));
-
-	/* spaces between calls. */
-	if(spaces != NULL)
-		free(spaces);
-	spaces = nmalloc(COLS * sizeof(int));
-
-	if(updates != NULL)
-		free(updates);
-	updates = nmalloc(COLS * sizeof(int));
+/* Initialize the display's variables, at the size of its screen. */
+void var_init(struct display *d)
+{
+	struct mtx_opts opts;
+	int w = COLS, h = LINES;
 
-	/* Make the matrix */
-	for(i = 0; i < LINES; i++)
+	/* with --subcell, the simulation is of the dots. */
+	if(subcell)
 	{
-		int j;
-		for(j=0; j<COLS; j+=2)
-			matrix[i][j] = MTX_BLANK;
+		mtx_sub_free(d->sub);
+		if(!(d->sub = mtx_sub_init(subcell, COLS, LINES)))
+			c_die("Cannot initialize the dots: %s\n", strerror(errno));
+		w = COLS * d->sub->sx * 2;
+		h = LINES * d->sub->sy;
 	}
 
-	for(i=0; i<COLS; i+=2)
+	/* (re)start the simulation at the current size, */
+	/* unless another display is already running one. */
+	if(d->mtx && !shared_mtx(d, d->mtx->cols, d->mtx->lines))
+		mtx_layers_free(d->mtx);
+	if(!(d->mtx = shared_mtx(d, w, h)))
 	{
-		/* Set up spaces[] array of how many spaces to skip */
-		spaces[i] = (int) rand_func() % LINES + 1;
+		memset(&opts, 0, sizeof(opts));
+		opts.flags = flags;
+		opts.randmin = randmin;
+		opts.randmax = randmax;
+		opts.rand = rand_func;
+		if(!(d->mtx = mtx_layers_init(w, h, nlayers, &opts)))
+			c_die("Cannot initialize the matrix: %s\n", strerror(errno));
+		mtx_layers_fastforward(d->mtx, warmup);
+	}
 
-		/* And length of the stream */
-		length[i] = (int) rand_func() % (LINES/2) + 3;
+	/* heads on screen. */
+	if(d->heads != NULL)
+		free(d->heads);
+	d->heads = nmalloc(sizeof(struct mtx_change) * LINES * COLS);
+	d->nheads = 0;
+	d->redraw = 1;
 
-		/* And set updates[] array for update speed. */
-		updates[i] = (int) rand_func() % 3 + 1;
+	/* message box location. */
+	if(flags & MTX_FLAG_MSG)
+	{
+		d->msg_y = LINES/2 - 1;
+		d->msg_x = (COLS - strlen(msg))/2 - 2;
+		d->msg_len = strlen(msg)+4;
 	}
 }
 
-short rand_char()
+int rand_char()
 {
 	return (rand_func() % (randmax - randmin)) + randmin;
 }
@@ -371,7 +576,7 @@ void sighandler(int s)
 }
 #endif
 
-void resize_screen(void)
+void resize_screen(struct display *d)
 {
 #ifdef _WIN32
 	BOOL result;
@@ -394,12 +599,17 @@ void resize_screen(void)
 	struct winsize win;
 
 	/* get size of tty. */
-	tty = ttyname(0);
-	if (!tty)
-		return;
-	fd = open(tty, O_RDWR);
-	if (fd == -1)
-		return;
+	if(d->file)
+		fd = fileno(d->file);
+	else
+	{
+		tty = ttyname(0);
+		if (!tty)
+			return;
+		fd = open(tty, O_RDWR);
+		if (fd == -1)
+			return;
+	}
 	result = ioctl(fd, TIOCGWINSZ, &win);
 	if (result == -1)
 		return;
@@ -424,7 +634,7 @@ void resize_screen(void)
 #endif /* HAVE_RESIZETERM */
 
 	/* realloc everything for new size. */
-	var_init();
+	var_init(d);
 	/* Do these because width may have changed... */
 	clear();
 	refresh();
@@ -449,24 +659,323 @@ void addch_utf8_altcharset(uint8_t c)
 }
 #endif
 
+#ifdef HAVE_NCURSESW_NCURSES_H
+/* the width comes with the glyph, so wide ones are just skipped when */
+/* they'd hang off the edge of the screen. */
+void draw_glyph(int x, int c)
+{
+	const struct mtxg_glyph *g = &glyphs.glyph[c - 1];
+
+	if(x + g->width > COLS)
+		addch(' ');
+	else
+		addstr(g->bytes);
+	/* and a narrow one over a wide one. */
+	if(g->width == 1 && x + 1 < COLS)
+		addch(' ');
+}
+#endif
+
+/* draw a single cell of the matrix. */
+/* cells from the layers behind the front one lose their bold and */
+/* their white heads, and from the third layer back they're dim too. */
+void draw_cell(struct display *d, int y, int x)
+{
+	struct mtx_layers *mtx = d->mtx;
+	int c = mtx->matrix[y][x];
+	int depth = mtx->depth[y * mtx->cols + x];
+	int color = mcolor, head = COLOR_WHITE;
+	uint32_t bold = depth ? 0 : flags & MTX_FLAG_BOLD;
+	int dim = depth > 1 ? A_DIM : 0;
+
+	/* rainbow colours go by column. */
+	if(flags & MTX_FLAG_RAINBOW)
+		color = color_vals[(x>>1) % 6];
+	if(depth)
+		head = color;
+
+	move(y, x);
+
+#ifndef HAVE_NCURSESW_NCURSES_H
+	if(flags & (MTX_FLAG_LINUX | MTX_FLAG_XWINDOW))
+		attron(A_ALTCHARSET);
+#endif
+
+	/* draw head. */
+	if(c == MTX_HEAD)
+	{
+		/* attrs. */
+		attron(COLOR_PAIR(head) | dim);
+		if(bold)
+			attron(A_BOLD);
+#ifdef HAVE_NCURSESW_NCURSES_H
+		if(glyphs.count)
+			draw_glyph(x, rand_char());
+		else if(flags & MTX_FLAG_UNICODE)
+			addstr(chars_array[rand_char()]);
+		else if(flags & (MTX_FLAG_LINUX | MTX_FLAG_XWINDOW))
+			addch_utf8_altcharset(rand_char());
+		else
+#endif
+			addch(rand_char());
+
+		attroff(COLOR_PAIR(head) | dim);
+		if(bold)
+			attroff(A_BOLD);
+	}
+	else if(c > 0)
+	{
+		/* enable effects. */
+		attron(COLOR_PAIR(color) | dim);
+		if((bold == MTX_FLAG_BOLD_ALL) || ((bold == MTX_FLAG_BOLD_SOME) && (c & 1)))
+			attron(A_BOLD);
+
+		/* draw char. */
+#ifdef HAVE_NCURSESW_NCURSES_H
+		if(flags & MTX_FLAG_LAMBDA)
+		{
+			addstr("λ");
+			/* over what may have been a wide glyph's head. */
+			if(glyphs.count && x + 1 < COLS)
+				addch(' ');
+		}
+		else if(glyphs.count)
+			draw_glyph(x, c);
+		else if(flags & MTX_FLAG_UNICODE)
+			addstr(chars_array[c]);
+		else if(flags & (MTX_FLAG_LINUX | MTX_FLAG_XWINDOW))
+			addch_utf8_altcharset(c);
+		else
+#endif
+			addch(c);
+
+		/* disable effects. */
+		if((bold == MTX_FLAG_BOLD_ALL) || ((bold == MTX_FLAG_BOLD_SOME) && (c & 1)))
+			attroff(A_BOLD);
+		attroff(COLOR_PAIR(color) | dim);
+	}
+#ifdef HAVE_NCURSESW_NCURSES_H
+	/* all of a wide glyph has to go, or curses keeps its right half. */
+	else if(glyphs.count && x + 1 < COLS)
+		addstr("  ");
+#endif
+	else
+		addch(' ');
+
+#ifndef HAVE_NCURSESW_NCURSES_H
+	if(flags & (MTX_FLAG_LINUX | MTX_FLAG_XWINDOW))
+		attroff(A_ALTCHARSET);
+#endif
+}
+
+#ifdef HAVE_NCURSESW_NCURSES_H
+/* draw a cell of --subcell dots. a head anywhere in it makes it white. */
+void draw_sub_cell(struct display *d, int cell)
+{
+	static char *half_blocks[4] = {" ", "▀", "▄", "█"};
+	struct mtx_sub *s = d->sub;
+	int g = s->glyph[cell], x = cell % s->cols;
+	int color = mcolor, bold;
+	char str[4];
+
+	move(cell / s->cols, x);
+	if(!g)
+	{
+		addch(' ');
+		return;
+	}
+
+	if(flags & MTX_FLAG_RAINBOW)
+		color = color_vals[x % 6];
+	if(s->head[cell])
+		color = COLOR_WHITE;
+	bold = ((flags & MTX_FLAG_BOLD) == MTX_FLAG_BOLD_ALL) ||
+	       ((flags & MTX_FLAG_BOLD) && (s->head[cell] || (g & 1)));
+
+	attron(COLOR_PAIR(color));
+	if(bold)
+		attron(A_BOLD);
+	if(s->mode == MTX_SUB_BRAILLE)
+	{
+		/* U+2800 + the dots. */
+		str[0] = 0xE2;
+		str[1] = 0xA0 | (g >> 6);
+		str[2] = 0x80 | (g & 0x3F);
+		str[3] = 0;
+		addstr(str);
+	}
+	else
+		addstr(half_blocks[g]);
+	if(bold)
+		attroff(A_BOLD);
+	attroff(COLOR_PAIR(color));
+}
+
+/* pack the dots the last step changed, and draw the cells that came out different. */
+void draw_sub_frame(struct display *d, int full)
+{
+	const struct mtx_change *changes;
+	size_t i, n;
+
+	if(full)
+	{
+		mtx_sub_load(d->sub, d->mtx->matrix);
+		mtx_sub_pack(d->sub);
+		for(i=0; i<(size_t) d->sub->cols * d->sub->lines; i++)
+			draw_sub_cell(d, i);
+		return;
+	}
+
+	changes = mtx_layers_changes(d->mtx, &n);
+	mtx_sub_apply(d->sub, d->mtx->matrix, changes, n);
+	mtx_sub_pack(d->sub);
+	for(i=0; i<d->sub->nchanged; i++)
+		draw_sub_cell(d, d->sub->changed[i]);
+}
+#endif
+
+/* draw what the last step changed, or everything if full is set. */
+void draw_frame(struct display *d, int full)
+{
+	struct mtx_layers *mtx = d->mtx;
+	struct mtx_change *heads = d->heads;
+	const struct mtx_change *changes;
+	size_t i, n, kept = 0;
+	int y, x;
+
+#ifdef HAVE_NCURSESW_NCURSES_H
+	if(d->sub)
+	{
+		draw_sub_frame(d, full);
+		return;
+	}
+#endif
+
+	if(full)
+	{
+		d->nheads = 0;
+		for(y=0; y<mtx->lines; y++)
+		{
+			for(x=0; x<mtx->cols; x+=2)
+			{
+				draw_cell(d, y, x);
+				if(mtx->matrix[y][x] == MTX_HEAD)
+				{
+					heads[d->nheads].y = y;
+					heads[d->nheads].x = x;
+					d->nheads++;
+				}
+			}
+		}
+		return;
+	}
+
+	/* the terminal moves everything down a row, heads included, */
+	/* and only the new top row is left to draw. */
+	if(mtx->scrolled)
+	{
+		scrollok(stdscr, TRUE);
+		scrl(-1);
+		scrollok(stdscr, FALSE);
+		for(i=0; i<d->nheads; i++)
+			heads[i].y++;
+	}
+
+	/* heads get a new char every frame, unless --cpu-budget is short. */
+	/* forget the ones that moved on. */
+	for(i=0; i<d->nheads; i++)
+	{
+		if(heads[i].y < mtx->lines && mtx->matrix[heads[i].y][heads[i].x] == MTX_HEAD)
+		{
+			if(quality < QUALITY_NO_REROLL)
+				draw_cell(d, heads[i].y, heads[i].x);
+			heads[kept++] = heads[i];
+		}
+	}
+	d->nheads = kept;
+
+	changes = mtx_layers_changes(mtx, &n);
+	for(i=0; i<n; i++)
+	{
+		draw_cell(d, changes[i].y, changes[i].x);
+		if(mtx->matrix[changes[i].y][changes[i].x] == MTX_HEAD && changes[i].old != MTX_HEAD)
+			heads[d->nheads++] = changes[i];
+	}
+}
+
+/* (re)attach the display's simulation to the --shared one for its size */
+/* and mode, when they change. without shared memory it runs on its own. */
+void share(struct display *d, int update)
+{
+	struct shared_key key;
+
+	memset(&key, 0, sizeof(key));
+	key.cols = d->mtx->cols;
+	key.lines = d->mtx->lines;
+	key.flags = flags & (MTX_FLAG_ASYNC | MTX_FLAG_OLD | MTX_FLAG_CHANGES | MTX_FLAG_PAUSE);
+	key.layers = nlayers;
+	key.randmin = randmin;
+	key.randmax = randmax;
+	key.update = update;
+	if(d->shm && !memcmp(&key, &d->key, sizeof(key)))
+		return;
+
+	shared_close(d->shm);
+	d->key = key;
+	if(!(d->shm = shared_open(&key)))
+	{
+		/* said on the way out, curses has the screen. */
+		shared_errno = errno;
+		use_shared = 0;
+	}
+}
+
+/* whether curses can move the screen down a row in the terminal instead */
+/* of redrawing it, with insert line or a scroll region and reverse index. */
+int can_scroll(void)
+{
+#ifndef _WIN32
+	char *csr = tigetstr("csr"), *ri = tigetstr("ri"), *rin = tigetstr("rin");
+
+	if(csr != NULL && csr != (char*) -1 &&
+	   ((ri != NULL && ri != (char*) -1) || (rin != NULL && rin != (char*) -1)))
+		return 1;
+#endif
+	return has_il();
+}
+
 int main(int argc, char *argv[])
 {
-	int i, j, y, z, keypress;
+	int i, keypress;
+	double frame_start = 0, last_start = 0;
+	int delay;
 
 	char *color_names[NUM_COLORS] = {"green",     "red",     "blue",     "yellow",     "cyan",     "magenta",     "white"};
-	int color_vals[NUM_COLORS]    = {COLOR_GREEN, COLOR_RED, COLOR_BLUE, COLOR_YELLOW, COLOR_CYAN, COLOR_MAGENTA, COLOR_WHITE};
-	int mcolor = COLOR_GREEN;
-	char *msg = NULL, *tty = NULL;
-	int count = 0;
+	struct display *d, *e;
+	char *tty;
+	int full, scroll = 1;
+#ifdef HAVE_NCURSESW_NCURSES_H
+	char *glyphs_file = NULL;
+#endif
 	int update = 4;
-	int msg_x=0, msg_y=0, msg_len=0; /* bluh, it 'might be used uninitialized,' bluh! */
+	struct render_opts video;
 
+	memset(&video, 0, sizeof(video));
+	video.cols = 80;
+	video.lines = 24;
+	video.frames = 300;
+
+	start_time = now();
 	srand((unsigned) time(NULL));
 
 	/* get arguments. */
 	while(1)
 	{
-		int optchr = getopt(argc, argv, "aAbBcfhklLnrosmpxVM:u:C:t:P:");
+#ifdef HAVE_GETOPT_H
+		int optchr = getopt_long(argc, argv, shortopts, longopts, NULL);
+#else
+		int optchr = getopt(argc, argv, shortopts);
+#endif
 		if(optchr == -1)
 			break;
 		if(optopt)
@@ -546,7 +1055,73 @@ int main(int argc, char *argv[])
 			case 'V': printf("%s", version); exit(0);
 			case 'r': flags |= MTX_FLAG_RAINBOW; break;
 			case 'k': flags |= MTX_FLAG_CHANGES; break;
-			case 't': tty = optarg; break;
+			case 't':
+				/* a list of ttys, or one more. */
+				for(tty=strtok(optarg, ","); tty; tty=strtok(NULL, ","))
+				{
+					if(ndisplays == MAX_DISPLAYS)
+						c_die("Too many ttys, the most is %d.\n", MAX_DISPLAYS);
+					displays[ndisplays++].tty = tty;
+				}
+				break;
+			case OPT_NO_INTRO: flags |= MTX_FLAG_NOINTRO; break;
+			case OPT_STATS: flags |= MTX_FLAG_STATS; break;
+			case OPT_RENDER_VIDEO: video.output = optarg; break;
+			case OPT_VIDEO_SIZE:
+				if(sscanf(optarg, "%dx%d", &video.cols, &video.lines)!=2 || video.cols<10 || video.lines<10)
+					c_die("Invalid video size, it should look like 80x24 and be at least 10x10.\n");
+				break;
+			case OPT_VIDEO_FRAMES:
+				if((video.frames = atoi(optarg)) < 1)
+					c_die("Invalid number of video frames.\n");
+				break;
+			case OPT_FONT: video.font = optarg; break;
+			case OPT_THREADS: video.threads = atoi(optarg); break;
+#ifdef HAVE_NCURSESW_NCURSES_H
+			case OPT_GLYPHS: glyphs_file = optarg; break;
+#else
+			case OPT_GLYPHS: fprintf(stderr, "cmatrix: '--glyphs' disabled at compile time, ignoring\n"); break;
+#endif
+			case OPT_LAYERS:
+				nlayers = atoi(optarg);
+				if(nlayers < 1 || nlayers > MTX_LAYERS_MAX)
+					c_die("Invalid number of layers, it should be 1 to 8.\n");
+				break;
+			case OPT_SHARED: use_shared = 1; break;
+#ifdef HAVE_NCURSESW_NCURSES_H
+			case OPT_SUBCELL:
+				if(!strcmp(optarg, "braille"))
+					subcell = MTX_SUB_BRAILLE;
+				else if(!strcmp(optarg, "half"))
+					subcell = MTX_SUB_HALF;
+				else
+					c_die("Invalid --subcell, it should be braille or half.\n");
+				break;
+#else
+			case OPT_SUBCELL: fprintf(stderr, "cmatrix: '--subcell' disabled at compile time, ignoring\n"); break;
+#endif
+			case OPT_PERF:
+				use_perf = 1;
+				flags |= MTX_FLAG_STATS;
+				break;
+			case OPT_WARMUP:
+				if((warmup = atoi(optarg)) < 0)
+					c_die("Invalid number of warmup frames.\n");
+				break;
+			case OPT_CPU_BUDGET:
+				i = 0;
+				if(sscanf(optarg, "%lf%n", &budget, &i) != 1 || budget <= 0)
+					c_die("Invalid --cpu-budget, it should look like 5%% or 2000us.\n");
+				if(!strcmp(optarg + i, "%") && budget <= 100)
+				{
+					budget /= 100;
+					budget_share = 1;
+				}
+				else if(!strcmp(optarg + i, "us") || !optarg[i])
+					budget /= 1e6;
+				else
+					c_die("Invalid --cpu-budget, it should look like 5%% or 2000us.\n");
+				break;
 		}
 	}
 
@@ -560,7 +1135,17 @@ int main(int argc, char *argv[])
 
 	/* set up values for random number generation. */
 #ifdef HAVE_NCURSESW_NCURSES_H
-	if(flags & MTX_FLAG_UNICODE)
+	if(glyphs_file)
+	{
+		if(glyphs_open(&glyphs, glyphs_file) == -1)
+		{
+			fprintf(stderr, "cmatrix: can't load glyph set '%s': %s\n", glyphs_file, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		randmin = 1;
+		randmax = glyphs.count + 1;
+	}
+	else if(flags & MTX_FLAG_UNICODE)
 	{
 		randmin = 1;
 		randmax = CHARS_LEN;
@@ -573,6 +1158,28 @@ int main(int argc, char *argv[])
 		randmax = 217;
 	}
 
+	/* --render-video doesn't need a terminal. */
+	if(video.output)
+	{
+		video.sim.flags = flags;
+		video.sim.randmin = randmin;
+		video.sim.randmax = randmax;
+		video.sim.rand = rand_func;
+		/* the font has the matrix glyphs, not the unicode ones. */
+#ifdef HAVE_NCURSESW_NCURSES_H
+		if((flags & MTX_FLAG_UNICODE) || glyphs.count)
+#else
+		if(flags & MTX_FLAG_UNICODE)
+#endif
+		{
+			video.sim.randmin = 166;
+			video.sim.randmax = 217;
+		}
+		video.color = mcolor;
+		video.fps = update > 0 ? 100 / update : 100;
+		exit(render_video(&video) ? EXIT_FAILURE : 0);
+	}
+
 	/* Clear TERM variable on Windows */
 #ifdef _WIN32
 	_putenv_s("TERM", "");
@@ -597,24 +1204,34 @@ int main(int argc, char *argv[])
 	}
 #endif
 
-	/* set tty if -t is set. */
-	if(tty)
+	/* without -t, just the terminal we're on. */
+	if(!ndisplays)
+		ndisplays = 1;
+
+	/* open a curses screen on each tty. */
+	for(d=displays; d<displays+ndisplays; d++)
 	{
-		FILE *ftty = fopen(tty, "r+");
-		SCREEN *ttyscr;
-		if(!ftty)
+		if(d->tty)
 		{
-			fprintf(stderr, "cmatrix: '%s' couldn't be opened: %s\n", tty, strerror(errno));
-			exit(EXIT_FAILURE);
+			if(!(d->file = fopen(d->tty, "r+")))
+			{
+				end_displays();
+				fprintf(stderr, "cmatrix: '%s' couldn't be opened: %s\n", d->tty, strerror(errno));
+				exit(EXIT_FAILURE);
+			}
+			d->screen = newterm(NULL, d->file, d->file);
 		}
-		ttyscr = newterm(NULL, ftty, ftty);
-		if(ttyscr == NULL)
+		else
+			d->screen = newterm(NULL, stdout, stdin);
+		if(d->screen == NULL)
+		{
+			end_displays();
+			fprintf(stderr, "cmatrix: can't set up the terminal on '%s'\n", d->tty ? d->tty : "stdout");
 			exit(EXIT_FAILURE);
-		set_term(ttyscr);
+		}
+		set_term(d->screen);
+		savetty();
 	}
-	else
-		initscr();
-	savetty();
 
 	/* change the font to matrix.psf if -l is set. */
 #ifdef HAVE_CONSOLECHARS
@@ -631,17 +1248,63 @@ int main(int argc, char *argv[])
 	}
 #endif
 
-	/* set up curses. */
-	nonl();
+	/* set up curses on each of them. */
+	for(d=displays; d<displays+ndisplays; d++)
+	{
+		set_term(d->screen);
+		nonl();
 #ifdef _WIN32
-	raw();
+		raw();
 #else
-	cbreak();
+		cbreak();
 #endif
-	noecho();
-	timeout(0);
-	leaveok(stdscr, TRUE);
-	curs_set(0);
+		noecho();
+		timeout(0);
+		leaveok(stdscr, TRUE);
+		curs_set(0);
+
+		/* -o without -a scrolls the terminals instead of redrawing all of them, */
+		/* if every one of them can, as they might share a simulation. */
+		if(can_scroll())
+			idlok(stdscr, TRUE);
+		else
+			scroll = 0;
+
+		if(has_colors())
+		{
+			start_color();
+			/* Add in colors, if available */
+#ifdef HAVE_USE_DEFAULT_COLORS
+			if(use_default_colors() != ERR)
+			{
+				init_pair(COLOR_BLACK, -1, -1);
+				init_pair(COLOR_GREEN, COLOR_GREEN, -1);
+				init_pair(COLOR_WHITE, COLOR_WHITE, -1);
+				init_pair(COLOR_RED, COLOR_RED, -1);
+				init_pair(COLOR_CYAN, COLOR_CYAN, -1);
+				init_pair(COLOR_MAGENTA, COLOR_MAGENTA, -1);
+				init_pair(COLOR_BLUE, COLOR_BLUE, -1);
+				init_pair(COLOR_YELLOW, COLOR_YELLOW, -1);
+			}
+			else
+#endif
+			{
+				init_pair(COLOR_BLACK, COLOR_BLACK, COLOR_BLACK);
+				init_pair(COLOR_GREEN, COLOR_GREEN, COLOR_BLACK);
+				init_pair(COLOR_WHITE, COLOR_WHITE, COLOR_BLACK);
+				init_pair(COLOR_RED, COLOR_RED, COLOR_BLACK);
+				init_pair(COLOR_CYAN, COLOR_CYAN, COLOR_BLACK);
+				init_pair(COLOR_MAGENTA, COLOR_MAGENTA, COLOR_BLACK);
+				init_pair(COLOR_BLUE, COLOR_BLUE, COLOR_BLACK);
+				init_pair(COLOR_YELLOW, COLOR_YELLOW, COLOR_BLACK);
+			}
+		}
+
+		/* malloc. */
+		var_init(d);
+	}
+	if(scroll)
+		flags |= MTX_FLAG_SCROLL;
 #ifndef _WIN32
 	/* these don't work properly under ansi, in my testing. */
 	signal(SIGINT, sighandler);
@@ -650,54 +1313,25 @@ int main(int argc, char *argv[])
 	signal(SIGTSTP, sighandler);
 #endif
 
-	if(has_colors())
-	{
-		start_color();
-		/* Add in colors, if available */
-#ifdef HAVE_USE_DEFAULT_COLORS
-		if(use_default_colors() != ERR)
-		{
-			init_pair(COLOR_BLACK, -1, -1);
-			init_pair(COLOR_GREEN, COLOR_GREEN, -1);
-			init_pair(COLOR_WHITE, COLOR_WHITE, -1);
-			init_pair(COLOR_RED, COLOR_RED, -1);
-			init_pair(COLOR_CYAN, COLOR_CYAN, -1);
-			init_pair(COLOR_MAGENTA, COLOR_MAGENTA, -1);
-			init_pair(COLOR_BLUE, COLOR_BLUE, -1);
-			init_pair(COLOR_YELLOW, COLOR_YELLOW, -1);
-		}
-		else
-#endif
-		{
-			init_pair(COLOR_BLACK, COLOR_BLACK, COLOR_BLACK);
-			init_pair(COLOR_GREEN, COLOR_GREEN, COLOR_BLACK);
-			init_pair(COLOR_WHITE, COLOR_WHITE, COLOR_BLACK);
-			init_pair(COLOR_RED, COLOR_RED, COLOR_BLACK);
-			init_pair(COLOR_CYAN, COLOR_CYAN, COLOR_BLACK);
-			init_pair(COLOR_MAGENTA, COLOR_MAGENTA, COLOR_BLACK);
-			init_pair(COLOR_BLUE, COLOR_BLUE, COLOR_BLACK);
-			init_pair(COLOR_YELLOW, COLOR_YELLOW, COLOR_BLACK);
-		}
-	}
-
-	/* malloc. */
-	var_init();
 	if(flags & MTX_FLAG_PREALLOC)
 		rand_pre_init();
 
-	/* message box location. */
-	if(flags & MTX_FLAG_MSG)
+	if(use_perf && perf_open(&perf) == -1)
 	{
-		msg_y = LINES/2 - 1;
-		msg_x = (COLS - strlen(msg))/2 - 2;
-		msg_len = strlen(msg)+4;
+		perf_errno = errno;
+		use_perf = 0;
 	}
 
 	/* === main loop === */
 	while(1)
 	{
+		PROBE1(frame_start, frames);
+		if(use_perf)
+			perf_mark(&perf, -1);
 #ifndef _WIN32
 		/* Check for signals */
+		if(signal_status)
+			PROBE1(signal, (int) signal_status);
 		switch(signal_status)
 		{
 			case SIGINT: case SIGQUIT: case SIGTSTP:
@@ -707,312 +1341,206 @@ int main(int argc, char *argv[])
 				break;
 
 			case SIGWINCH:
-				resize_screen();
-				/* update with new COLS or LINES. */
-				if(flags & MTX_FLAG_MSG)
+				/* it doesn't say which, so check them all. */
+				for(d=displays; d<displays+ndisplays; d++)
 				{
-					msg_y = LINES/2;
-					msg_x = (COLS - strlen(msg))/2;
+					set_term(d->screen);
+					resize_screen(d);
+					PROBE2(resize, COLS, LINES);
 				}
 				signal_status = 0;
 				break;
 		}
 #endif
 
-		/* update and draw matrix. */
-		for(j=0; j<COLS; j+=2)
+		if((flags & MTX_FLAG_STATS) || budget > 0)
 		{
-			/* update column (if turn and not paused). */
-			if((count > updates[j] || !(flags & MTX_FLAG_ASYNC)) && !(flags & MTX_FLAG_PAUSE))
-			{
-				/* old-style (real) scrolling. */
-				if(flags & MTX_FLAG_OLD)
-				{
-					y=0;
-					flags |= MTX_FLAG_CONCURCOL;
-					/* scroll the whole column down. */
-					for(i=LINES-1; i>=1; i--)
-					{
-						matrix[i][j] = matrix[i - 1][j];
-						/* get length of column, resetting when reaching the next. */
-						if(flags & MTX_FLAG_CONCURCOL)
-						{
-							if(matrix[i][j]==MTX_BLANK)
-								flags &= ~MTX_FLAG_CONCURCOL;
-							else
-								y++;
-						}
-						else
-						{
-							if(matrix[i][j]!=MTX_BLANK)
-							{
-								y=0;
-								flags |= MTX_FLAG_CONCURCOL;
-							}
-						}
-					}
-					/* create new column. */
-					if(matrix[1][j] == MTX_BLANK)
-					{
-						/* fill gap with blanks. */
-						if(spaces[j]>0)
-						{
-							matrix[0][j] = MTX_BLANK;
-							spaces[j]--;
-						}
-						else
-						{
-							/* Random number to determine whether head of next collumn
-							   of chars has a white 'head' on it. */
-							if((rand_func() % 3) == 1)
-								matrix[0][j] = MTX_HEAD;
-							else
-								matrix[0][j] = rand_char();
-							length[j] = (rand_func() % (LINES/2)) + 3;
-							spaces[j] = (rand_func() % LINES) + 1;
-						}
-					}
-					/* fill in column. */
-					else if(y<length[j])
-						matrix[0][j] = rand_char();
-					/* create gap. */
-					else
-						matrix[0][j] = MTX_BLANK;
-				}
-				/* new-style (fake) scrolling. */
-				else
-				{
-					/* last column is done growing. */
-					if(matrix[0][j] == MTX_BLANK)
-					{
-						if(spaces[j] > 0)
-							spaces[j]--;
-						/* create new column. */
-						else
-						{
-							length[j] = (rand_func() % (LINES/2)) + 3;
-							matrix[0][j] = MTX_HEAD;
-							spaces[j] = (rand_func() % LINES) + 1;
-						}
-					}
-					i = 0;
-					y = 0;
-					flags &= ~MTX_FLAG_FIRSTCOL;
-					while(i < LINES)
-					{
-						/* Skip over spaces */
-						while (i < LINES && matrix[i][j] == MTX_BLANK)
-							i++;
-						if(i >= LINES)
-							break;
+			last_start = frame_start;
+			frame_start = now();
+		}
 
-						/* Go to the end of this column */
-						z = i;
-						y = 0;
-						while(i < LINES && matrix[i][j] != MTX_BLANK)
-						{
-							if(flags & MTX_FLAG_CHANGES)
-							{
-								if(!(rand_func() & 7))
-									matrix[i][j] = rand_char();
-							}
-							i++;
-							y++;
-						}
-
-						/* replace old head with normal char. */
-						if(i && matrix[i-1][j] == MTX_HEAD)
-							matrix[i-1][j] = rand_char();
-
-						/* create new head. */
-						if(i < LINES)
-							matrix[i][j] = MTX_HEAD;
-
-						/* If we're at the top of the column and it's reached its
-						   full length (about to start moving down), we do this
-						   to get it moving.  This is also how we keep segment_sizes not
-						   already growing from growing accidentally => */
-						if(y > length[j] || (flags & MTX_FLAG_FIRSTCOL))
-							matrix[z][j] = MTX_BLANK;
-						flags |= MTX_FLAG_FIRSTCOL;
-						i++;
-					}
-				}
+		/* update each simulation once, however many displays show it. */
+		for(d=displays; d<displays+ndisplays; d++)
+		{
+			for(e=displays; e->mtx!=d->mtx; e++)
+				;
+			if(e < d)
+			{
+				/* it's the other display's to share now. */
+				shared_close(d->shm);
+				d->shm = NULL;
+				continue;
 			}
+			/* a scroll of dots isn't one of cells. */
+			d->mtx->flags = d->sub ? flags & ~MTX_FLAG_SCROLL : flags;
+			if(quality >= QUALITY_NO_CHANGES)
+				d->mtx->flags &= ~MTX_FLAG_CHANGES;
+			if(quality >= QUALITY_SPARSE)
+				d->mtx->flags |= MTX_FLAG_SPARSE;
+			if(use_shared)
+				share(d, update);
+			if(d->shm)
+				d->fresh = shared_step(d->shm, d->mtx);
+			else
+				mtx_layers_step(d->mtx);
+			if(!d->shm || shared_publishing(d->shm))
+				sim_frames++;
+		}
+		full = redraw;
+		redraw = 0;
+		PROBE1(simulated, frames);
+		if(use_perf)
+			perf_mark(&perf, PHASE_SIMULATE);
 
-			/* draw each line. */
-			for(i = 0; i < LINES; i++)
+		for(d=displays; d<displays+ndisplays; d++)
+		{
+			/* draw matrix, unless it's shared and there's nothing new. */
+			set_term(d->screen);
+			for(e=displays; e->mtx!=d->mtx; e++)
+				;
+			if(!e->shm || e->fresh || full || d->redraw)
+				draw_frame(d, full || d->redraw);
+
+			/* if -M or -L. */
+			if(flags & MTX_FLAG_MSG)
 			{
-				move(i, j);
-
-#ifndef HAVE_NCURSESW_NCURSES_H
-				if(flags & (MTX_FLAG_LINUX | MTX_FLAG_XWINDOW))
-					attron(A_ALTCHARSET);
-#endif
-
-				/* draw head. */
-				if(matrix[i][j] == MTX_HEAD)
+				/* the box doesn't scroll, so put back the row it was scrolled onto. */
+				if(d->mtx->scrolled && !(full || d->redraw) && d->msg_y + 3 < LINES)
 				{
-					/* attrs. */
-					attron(COLOR_PAIR(COLOR_WHITE));
-					if(flags & MTX_FLAG_BOLD)
-						attron(A_BOLD);
-#ifdef HAVE_NCURSESW_NCURSES_H
-					if(flags & MTX_FLAG_UNICODE)
-						addstr(chars_array[rand_char()]);
-					else if(flags & (MTX_FLAG_LINUX | MTX_FLAG_XWINDOW))
-						addch_utf8_altcharset(rand_char());
-					else
-#endif
-						addch(rand_char());
-
-
-					attroff(COLOR_PAIR(COLOR_WHITE));
-					if(flags & MTX_FLAG_BOLD)
-						attroff(A_BOLD);
-
-					if(flags & MTX_FLAG_RAINBOW)
-						mcolor = color_vals[(j>>1) % 6];
+					for(i=(d->msg_x > 0 ? d->msg_x & ~1 : 0); i<d->msg_x+d->msg_len && i<COLS; i+=2)
+						draw_cell(d, d->msg_y + 3, i);
 				}
-				else if(matrix[i][j] > 0)
-				{
-					/* enable effects. */
-					attron(COLOR_PAIR(mcolor));
-					if(((flags & MTX_FLAG_BOLD) == MTX_FLAG_BOLD_ALL) || (((flags & MTX_FLAG_BOLD) == MTX_FLAG_BOLD_SOME) && (matrix[i][j] & 1)))
-						attron(A_BOLD);
 
-					/* draw char. */
-#ifdef HAVE_NCURSESW_NCURSES_H
-					if(flags & MTX_FLAG_LAMBDA)
-						addstr("λ");
-					else if(flags & MTX_FLAG_UNICODE)
-						addstr(chars_array[matrix[i][j]]);
-					else if(flags & (MTX_FLAG_LINUX | MTX_FLAG_XWINDOW))
-						addch_utf8_altcharset(matrix[i][j]);
-					else
-#endif
-						addch(matrix[i][j]);
-
-					/* disable effects. */
-					if(((flags & MTX_FLAG_BOLD) == MTX_FLAG_BOLD_ALL) || (((flags & MTX_FLAG_BOLD) == MTX_FLAG_BOLD_SOME) && (matrix[i][j] & 1)))
-						attroff(A_BOLD);
-					attroff(COLOR_PAIR(mcolor));
-				}
-				else
+				move(d->msg_y, d->msg_x);
+				for(i=0; i<d->msg_len; i++)
 					addch(' ');
 
-#ifndef HAVE_NCURSESW_NCURSES_H
-				if(flags & (MTX_FLAG_LINUX | MTX_FLAG_XWINDOW))
-					attroff(A_ALTCHARSET);
-#endif
-			}
-		}
-
-		/* if -M or -L. */
-		if(flags & MTX_FLAG_MSG)
-		{
-			move(msg_y, msg_x);
-			for(i=0; i<msg_len; i++)
-				addch(' ');
-
-			move(msg_y+1, msg_x);
-			addstr("  ");
-			addstr(msg);
-			addstr("  ");
+				move(d->msg_y+1, d->msg_x);
+				addstr("  ");
+				addstr(msg);
+				addstr("  ");
 
-			move(msg_y+2, msg_x);
-			for(i=0; i<msg_len; i++)
-				addch(' ');
-		}
-
-		/* get user input. */
-		/* this also redraws the screen, because curses is weird. */
-		if((keypress = getch()) != ERR)
-		{
-			/* if screensaver, exit on keypress. */
-			if(flags & MTX_FLAG_SCRSAVE)
-			{
-#ifdef USE_TIOCSTI
-				/* collect immediately following keypresses into str. */
-				char *str = malloc(0);
-				size_t str_len = 0, i;
-				do
-				{
-					str = realloc(str, str_len + 1);
-					str[str_len++] = keypress;
-				} while((keypress = getch()) != ERR);
-				/* type chars to tty so the shell can see them. */
-				for(i=0; i<str_len; i++)
-					ioctl(STDIN_FILENO, TIOCSTI, (char*)(str + i));
-				free(str);
-#endif
-				finish();
+				move(d->msg_y+2, d->msg_x);
+				for(i=0; i<d->msg_len; i++)
+					addch(' ');
 			}
-			/* allow for settings to be changed at runtime. */
-			else
+			d->redraw = 0;
+			PROBE2(drawn, frames, (int) (d - displays));
+			if(use_perf)
+				perf_mark(&perf, PHASE_DRAW);
+
+			/* get user input. */
+			/* this also redraws the screen, because curses is weird. */
+			if((keypress = getch()) != ERR)
 			{
-				switch(keypress)
+				/* if screensaver, exit on keypress. */
+				if(flags & MTX_FLAG_SCRSAVE)
 				{
+#ifdef USE_TIOCSTI
+					/* collect immediately following keypresses into str. */
+					char *str = malloc(0);
+					size_t str_len = 0, i;
+					do
+					{
+						str = realloc(str, str_len + 1);
+						str[str_len++] = keypress;
+					} while((keypress = getch()) != ERR);
+					/* type chars to tty so the shell can see them. */
+					for(i=0; i<str_len; i++)
+						ioctl(d->file ? fileno(d->file) : STDIN_FILENO, TIOCSTI, (char*)(str + i));
+					free(str);
+#endif
+					finish();
+				}
+				/* allow for settings to be changed at runtime. */
+				else
+				{
+					switch(keypress)
+					{
 #ifdef _WIN32
-					case 3: /* Ctrl-C. Fall through */
+						case 3: /* Ctrl-C. Fall through */
 #endif
-					case 'q': case 'Q':
-						if(!(flags & MTX_FLAG_LOCK))
-							finish();
-						break;
-					case 'a': case 'A': flags ^= MTX_FLAG_ASYNC; break;
-					case 'b': flags = (flags & ~MTX_FLAG_BOLD) | MTX_FLAG_BOLD_SOME; break;
-					case 'B': flags = (flags & ~MTX_FLAG_BOLD) | MTX_FLAG_BOLD_ALL; break;
-					case 'n': case 'N': flags &= ~MTX_FLAG_BOLD; break;
-					case 'o': case 'O': flags ^= MTX_FLAG_OLD; break;
-					case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
-						update = keypress - '0';
-						break;
-					/* colors. annoying duplicated code. */
-					case '!':
-						mcolor = COLOR_RED;
-						flags &= ~MTX_FLAG_RAINBOW;
-						break;
-					case '@':
-						mcolor = COLOR_GREEN;
-						flags &= ~MTX_FLAG_RAINBOW;
-						break;
-					case '#':
-						mcolor = COLOR_YELLOW;
-						flags &= ~MTX_FLAG_RAINBOW;
-						break;
-					case '$':
-						mcolor = COLOR_BLUE;
-						flags &= ~MTX_FLAG_RAINBOW;
-						break;
-					case '%':
-						mcolor = COLOR_MAGENTA;
-						flags &= ~MTX_FLAG_RAINBOW;
-						break;
-					case '^':
-						mcolor = COLOR_CYAN;
-						flags &= ~MTX_FLAG_RAINBOW;
-						break;
-					case '&':
-						mcolor = COLOR_WHITE;
-						flags &= ~MTX_FLAG_RAINBOW;
-						break;
-					case 'r': case 'R': flags ^= MTX_FLAG_RAINBOW; break;
+						case 'q': case 'Q':
+							if(!(flags & MTX_FLAG_LOCK))
+								finish();
+							break;
+						case 'a': case 'A': flags ^= MTX_FLAG_ASYNC; break;
+						case 'b': flags = (flags & ~MTX_FLAG_BOLD) | MTX_FLAG_BOLD_SOME; redraw = 1; break;
+						case 'B': flags = (flags & ~MTX_FLAG_BOLD) | MTX_FLAG_BOLD_ALL; redraw = 1; break;
+						case 'n': case 'N': flags &= ~MTX_FLAG_BOLD; redraw = 1; break;
+						case 'o': case 'O': flags ^= MTX_FLAG_OLD; break;
+						case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9':
+							update = keypress - '0';
+							break;
+						/* colors. annoying duplicated code. */
+						case '!':
+							mcolor = COLOR_RED;
+							flags &= ~MTX_FLAG_RAINBOW;
+							redraw = 1;
+							break;
+						case '@':
+							mcolor = COLOR_GREEN;
+							flags &= ~MTX_FLAG_RAINBOW;
+							redraw = 1;
+							break;
+						case '#':
+							mcolor = COLOR_YELLOW;
+							flags &= ~MTX_FLAG_RAINBOW;
+							redraw = 1;
+							break;
+						case '$':
+							mcolor = COLOR_BLUE;
+							flags &= ~MTX_FLAG_RAINBOW;
+							redraw = 1;
+							break;
+						case '%':
+							mcolor = COLOR_MAGENTA;
+							flags &= ~MTX_FLAG_RAINBOW;
+							redraw = 1;
+							break;
+						case '^':
+							mcolor = COLOR_CYAN;
+							flags &= ~MTX_FLAG_RAINBOW;
+							redraw = 1;
+							break;
+						case '&':
+							mcolor = COLOR_WHITE;
+							flags &= ~MTX_FLAG_RAINBOW;
+							redraw = 1;
+							break;
+						case 'r': case 'R': flags ^= MTX_FLAG_RAINBOW; redraw = 1; break;
 #ifdef HAVE_NCURSESW_NCURSES_H
-					case 'm': case 'M':
-						if(!(flags & (MTX_FLAG_XWINDOW | MTX_FLAG_LINUX)))
-							flags ^= MTX_FLAG_LAMBDA;
-						break;
+						case 'm': case 'M':
+							if(!(flags & (MTX_FLAG_XWINDOW | MTX_FLAG_LINUX)))
+								flags ^= MTX_FLAG_LAMBDA;
+							redraw = 1;
+							break;
 #endif
-					case 'p': case 'P': flags ^= MTX_FLAG_PAUSE; break;
-					case 'k': case 'K': flags ^= MTX_FLAG_CHANGES; break;
+						case 'p': case 'P': flags ^= MTX_FLAG_PAUSE; break;
+						case 'k': case 'K': flags ^= MTX_FLAG_CHANGES; break;
+					}
 				}
 			}
+			PROBE2(refreshed, frames, (int) (d - displays));
+			if(use_perf)
+				perf_mark(&perf, PHASE_REFRESH);
+		}
+
+		if((flags & MTX_FLAG_STATS) || budget > 0)
+		{
+			busy_time += now() - frame_start;
+			if(!frames)
+				first_frame = now();
+			if(budget > 0 && last_start > 0)
+				govern(now() - frame_start, frame_start - last_start);
 		}
+		frames++;
 
 		/* next iteration. */
-		count = (count % 4) + 1;
-		napms(update * 10);
+		delay = update * 10;
+		if(quality >= QUALITY_SLOW)
+			delay = delay > 0 ? delay * 2 : 10;
+		napms(delay);
 	}
 	finish();
 }
@@ -0,0 +1,134 @@
+ /**********************************************************************\
+ | glyphs.c                                                             |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifndef EXCLUDE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "glyphs.h"
+
+/* make sure the file is what it says it is, so the hot path doesn't have to. */
+static int check(struct glyphset *g)
+{
+	const unsigned char *p = g->map;
+	uint32_t i;
+
+	if(g->size < MTXG_HEADER || memcmp(p, MTXG_MAGIC, 4) ||
+	   (p[4] | (p[5] << 8)) != MTXG_VERSION ||
+	   (p[6] | (p[7] << 8)) != sizeof(struct mtxg_glyph))
+		return -1;
+
+	g->count = p[8] | (p[9] << 8) | (p[10] << 16) | ((uint32_t) p[11] << 24);
+	g->glyph = (const struct mtxg_glyph*) (p + MTXG_HEADER);
+	if(g->count < 1 || g->count > MTXG_MAX ||
+	   g->size != MTXG_HEADER + (size_t) g->count * sizeof(struct mtxg_glyph))
+		return -1;
+
+	for(i=0; i<g->count; i++)
+	{
+		if(g->glyph[i].width < 1 || g->glyph[i].width > 2 ||
+		   g->glyph[i].len < 1 || g->glyph[i].len >= MTXG_BYTES ||
+		   g->glyph[i].bytes[g->glyph[i].len] != '\0')
+			return -1;
+	}
+	return 0;
+}
+
+int glyphs_open(struct glyphset *g, const char *path)
+{
+	struct stat st;
+	int fd;
+
+	memset(g, 0, sizeof(struct glyphset));
+	if((fd = open(path, O_RDONLY)) == -1)
+		return -1;
+	if(fstat(fd, &st) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+	if(st.st_size < MTXG_HEADER || st.st_size > MTXG_HEADER + MTXG_MAX * (off_t) sizeof(struct mtxg_glyph))
+	{
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	g->size = st.st_size;
+
+#ifdef HAVE_SYS_MMAN_H
+	g->map = mmap(NULL, g->size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(g->map == MAP_FAILED)
+	{
+		g->map = NULL;
+		return -1;
+	}
+#else
+	/* no mmap, read it in instead. */
+	if(!(g->map = malloc(g->size)) || read(fd, g->map, g->size) != (ssize_t) g->size)
+	{
+		free(g->map);
+		g->map = NULL;
+		close(fd);
+		errno = EINVAL;
+		return -1;
+	}
+	close(fd);
+#endif
+
+	if(check(g) == -1)
+	{
+		glyphs_close(g);
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+void glyphs_close(struct glyphset *g)
+{
+	if(g->map == NULL)
+		return;
+#ifdef HAVE_SYS_MMAN_H
+	munmap(g->map, g->size);
+#else
+	free(g->map);
+#endif
+	memset(g, 0, sizeof(struct glyphset));
+}
@@ -0,0 +1,61 @@
+ /**********************************************************************\
+ | glyphs.h                                                             |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+/* compiled glyph sets for --glyphs, made by mtxglyph from a text list. */
+/* the file is a header followed by fixed size entries, so it can be */
+/* mapped as is and a cell value indexes straight into it: */
+/*   "MTXG", version (le16), entry size (le16), count (le32), 0 (le32) */
+/*   count entries of: width, length, utf-8 bytes padded with NULs. */
+
+#ifndef GLYPHS_H
+#define GLYPHS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MTXG_MAGIC    "MTXG"
+#define MTXG_VERSION  1
+#define MTXG_HEADER   16
+#define MTXG_BYTES    14        /* room for the encoding and its NUL. */
+#define MTXG_MAX      65536
+
+struct mtxg_glyph
+{
+	uint8_t width;              /* terminal columns, 1 or 2. */
+	uint8_t len;                /* length of bytes, not counting the NUL. */
+	char bytes[MTXG_BYTES];     /* utf-8, ready for addstr(). */
+};
+
+struct glyphset
+{
+	const struct mtxg_glyph *glyph;
+	uint32_t count;
+	void *map;                  /* the whole file. */
+	size_t size;
+};
+
+/* 0 on success, -1 with errno set (EINVAL for a file that isn't a glyph set). */
+int glyphs_open(struct glyphset *g, const char *path);
+void glyphs_close(struct glyphset *g);
+
+#endif /* GLYPHS_H */
@@ -0,0 +1,273 @@
+ /**********************************************************************\
+ | layers.c                                                             |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mtx.h"
+
+struct mtx_layers *mtx_layers_init(int w, int h, int n, const struct mtx_opts *opts)
+{
+	struct mtx_layers *l;
+	struct mtx_opts o;
+	int i, speed;
+
+	if(n < 1 || n > MTX_LAYERS_MAX)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+	if(!(l = calloc(1, sizeof(struct mtx_layers))))
+		return NULL;
+	l->lines = h;
+	l->cols = w;
+	l->flags = opts->flags;
+	l->n = n;
+
+	/* each layer back is a third slower and has gaps one normal gap longer. */
+	o = *opts;
+	speed = opts->speed > 0 ? opts->speed : MTX_TICK;
+	for(i=0; i<n; i++)
+	{
+		o.speed = speed * 3 / (i + 3);
+		o.gaps = (opts->gaps > 0 ? opts->gaps : MTX_TICK) * (i + 1);
+		if(!(l->layer[i] = mtx_init(w, h, &o)))
+		{
+			mtx_layers_free(l);
+			return NULL;
+		}
+	}
+
+	/* a single layer is already what's on top. */
+	l->matrix = l->layer[0]->matrix;
+	l->depth = calloc((size_t) h * w, 1);
+	if(!l->depth)
+	{
+		mtx_layers_free(l);
+		errno = ENOMEM;
+		return NULL;
+	}
+	if(n == 1)
+		return l;
+
+	l->tiles_x = (w + MTX_TILE_COLS - 1) / MTX_TILE_COLS;
+	l->tiles_y = (h + MTX_TILE_LINES - 1) / MTX_TILE_LINES;
+	l->matrix = malloc(sizeof(int*) * h);
+	if(l->matrix)
+		l->matrix[0] = malloc(sizeof(int) * h * w);
+	l->dirty = calloc((size_t) l->tiles_x * l->tiles_y, 1);
+	l->changes = malloc(sizeof(struct mtx_change) * h * w);
+	l->scratch = malloc(sizeof(int) * h * w);
+	if(!l->matrix || !l->matrix[0] || !l->dirty || !l->changes || !l->scratch)
+	{
+		mtx_layers_free(l);
+		errno = ENOMEM;
+		return NULL;
+	}
+	for(i=1; i<h; i++)
+		l->matrix[i] = l->matrix[i - 1] + w;
+	for(i=0; i<h * w; i++)
+		l->matrix[0][i] = MTX_BLANK;
+
+	return l;
+}
+
+void mtx_layers_free(struct mtx_layers *l)
+{
+	int i;
+
+	if(l == NULL)
+		return;
+	if(l->n > 1 && l->matrix)
+	{
+		free(l->matrix[0]);
+		free(l->matrix);
+	}
+	for(i=0; i<l->n; i++)
+		mtx_free(l->layer[i]);
+	free(l->depth);
+	free(l->dirty);
+	free(l->changes);
+	free(l->scratch);
+	free(l);
+}
+
+/* put whatever is on top in every used cell of tile tx, ty, */
+/* and record the cells that came out different. */
+static void composite_tile(struct mtx_layers *l, int tx, int ty)
+{
+	const int *layer[MTX_LAYERS_MAX];
+	int *top = l->matrix[0];
+	int y, x, k, val, ymax, xmax;
+	size_t cell;
+
+	for(k=0; k<l->n; k++)
+		layer[k] = l->layer[k]->matrix[0];
+
+	ymax = (ty + 1) * MTX_TILE_LINES;
+	if(ymax > l->lines)
+		ymax = l->lines;
+	xmax = (tx + 1) * MTX_TILE_COLS;
+	if(xmax > l->cols)
+		xmax = l->cols;
+
+	for(y=ty * MTX_TILE_LINES; y<ymax; y++)
+	{
+		for(x=tx * MTX_TILE_COLS; x<xmax; x+=2)
+		{
+			cell = (size_t) y * l->cols + x;
+			val = MTX_BLANK;
+			for(k=0; k<l->n; k++)
+			{
+				if((val = layer[k][cell]) != MTX_BLANK)
+					break;
+			}
+			if(k == l->n)
+				k = 0;
+
+			/* the same character from a different layer looks different. */
+			if(val != top[cell] || k != l->depth[cell])
+			{
+				l->changes[l->nchanges].y = y;
+				l->changes[l->nchanges].x = x;
+				l->changes[l->nchanges].old = top[cell];
+				l->nchanges++;
+				top[cell] = val;
+				l->depth[cell] = k;
+			}
+		}
+	}
+}
+
+void mtx_layers_step(struct mtx_layers *l)
+{
+	const struct mtx_change *c;
+	size_t i, n, cell;
+	int k, t;
+
+	/* only a single layer can be scrolled. */
+	for(k=0; k<l->n; k++)
+	{
+		l->layer[k]->flags = l->n == 1 ? l->flags : l->flags & ~MTX_FLAG_SCROLL;
+		mtx_step(l->layer[k]);
+	}
+	if(l->n == 1)
+	{
+		l->scrolled = l->layer[0]->scrolled;
+		return;
+	}
+
+	/* find the tiles anything visible happened in. a change under a cell */
+	/* a layer further forward had last time is hidden, unless that layer */
+	/* changed the cell too, and then it has marked the tile itself. */
+	for(k=0; k<l->n; k++)
+	{
+		c = mtx_changes(l->layer[k], &n);
+		for(i=0; i<n; i++)
+		{
+			cell = (size_t) c[i].y * l->cols + c[i].x;
+			if(l->depth[cell] < k && l->matrix[0][cell] != MTX_BLANK)
+				continue;
+			l->dirty[(c[i].y / MTX_TILE_LINES) * l->tiles_x + c[i].x / MTX_TILE_COLS] = 1;
+		}
+	}
+
+	l->nchanges = 0;
+	for(t=0; t<l->tiles_x * l->tiles_y; t++)
+	{
+		if(l->dirty[t])
+		{
+			composite_tile(l, t % l->tiles_x, t / l->tiles_x);
+			l->dirty[t] = 0;
+		}
+	}
+}
+
+void mtx_layers_fastforward(struct mtx_layers *l, int frames)
+{
+	int k, tx, ty;
+
+	l->scrolled = 0;
+	for(k=0; k<l->n; k++)
+	{
+		l->layer[k]->flags = l->n == 1 ? l->flags : l->flags & ~MTX_FLAG_SCROLL;
+		mtx_fastforward(l->layer[k], frames);
+	}
+	if(l->n == 1)
+		return;
+
+	for(ty=0; ty<l->tiles_y; ty++)
+	{
+		for(tx=0; tx<l->tiles_x; tx++)
+			composite_tile(l, tx, ty);
+	}
+	l->nchanges = 0;
+}
+
+void mtx_layers_show(struct mtx_layers *l, const int *cells, const uint8_t *depth)
+{
+	int y, x, k;
+	size_t cell;
+
+	l->scrolled = 0;
+	if(l->n == 1)
+	{
+		mtx_show(l->layer[0], cells);
+		return;
+	}
+
+	/* give each layer its part. */
+	for(k=0; k<l->n; k++)
+	{
+		for(cell=0; cell<(size_t) l->lines * l->cols; cell++)
+			l->scratch[cell] = depth[cell] == k ? cells[cell] : MTX_BLANK;
+		mtx_show(l->layer[k], l->scratch);
+	}
+
+	l->nchanges = 0;
+	for(y=0; y<l->lines; y++)
+	{
+		for(x=0; x<l->cols; x+=2)
+		{
+			cell = (size_t) y * l->cols + x;
+			if(cells[cell] != l->matrix[y][x] || depth[cell] != l->depth[cell])
+			{
+				l->changes[l->nchanges].y = y;
+				l->changes[l->nchanges].x = x;
+				l->changes[l->nchanges].old = l->matrix[y][x];
+				l->nchanges++;
+				l->matrix[y][x] = cells[cell];
+				l->depth[cell] = depth[cell];
+			}
+		}
+	}
+}
+
+const struct mtx_change *mtx_layers_changes(const struct mtx_layers *l, size_t *n)
+{
+	if(l->n == 1)
+		return mtx_changes(l->layer[0], n);
+	*n = l->nchanges;
+	return l->changes;
+}
@@ -0,0 +1,599 @@
+ /**********************************************************************\
+ | mtx.c                                                                |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mtx.h"
+
+static int rand_char(struct mtx *m)
+{
+	return (m->rand() % (m->randmax - m->randmin)) + m->randmin;
+}
+
+/* every write to the matrix goes through here so it ends up in the change list. */
+static void set_cell(struct mtx *m, int y, int x, int val)
+{
+	size_t k = (size_t) y * m->cols + x;
+
+	if(m->stamp[k] != m->gen)
+	{
+		m->stamp[k] = m->gen;
+		m->changes[m->nchanges].y = y;
+		m->changes[m->nchanges].x = x;
+		m->changes[m->nchanges].old = m->matrix[y][x];
+		m->nchanges++;
+	}
+	m->matrix[y][x] = val;
+}
+
+/* gap before the next stream in a line. */
+static int new_spaces(struct mtx *m)
+{
+	int spaces = ((m->rand() % m->lines) + 1) * m->gaps / MTX_TICK;
+
+	if(m->flags & MTX_FLAG_SPARSE)
+		spaces *= 2;
+	return spaces > 0 ? spaces : 1;
+}
+
+/* live cells to pass before the next -k change, so that each cell */
+/* still changes with a chance of 1/MTX_MUTATE. gaps are cut off at */
+/* MTX_GAPS, which one in 5000 or so would go past. */
+static int mutation_gap(struct mtx *m)
+{
+	int r = m->rand(), lo = 0, hi = MTX_GAPS, mid;
+
+	/* the thresholds go down, find how many the draw is under. */
+	while(lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if(r < m->gap_at[mid])
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* put line j in the wheel slot of the frame it's due in. */
+static void schedule(struct mtx *m, int j)
+{
+	int slot = (m->due[j] / MTX_TICK) % MTX_WHEEL;
+
+	m->next[j] = m->wheel[slot];
+	m->wheel[slot] = j;
+}
+
+/* (re)schedule every line, starting from the current frame. */
+static void build_wheel(struct mtx *m)
+{
+	int j;
+
+	m->async = m->flags & MTX_FLAG_ASYNC;
+	for(j=0; j<MTX_WHEEL; j++)
+		m->wheel[j] = -1;
+	for(j=0; j<m->cols; j+=2)
+	{
+		/* spread asynchronous lines out over their first period. */
+		m->due[j] = m->tick * MTX_TICK;
+		if(m->async)
+			m->due[j] += m->rand() % m->updates[j];
+		schedule(m, j);
+	}
+}
+
+struct mtx *mtx_init(int w, int h, const struct mtx_opts *opts)
+{
+	struct mtx *m;
+	double p;
+	int i;
+
+	/* streams are at least 3 long and start at row 1 or lower. */
+	if(w < 1 || h < 2 || opts->randmax <= opts->randmin)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if(!(m = calloc(1, sizeof(struct mtx))))
+		return NULL;
+	m->lines = h;
+	m->cols = w;
+	m->flags = opts->flags;
+	m->randmin = opts->randmin;
+	m->randmax = opts->randmax;
+	m->rand = opts->rand ? opts->rand : &rand;
+	m->period = MTX_TICK;
+	if(opts->speed > 0)
+		m->period = MTX_TICK * MTX_TICK / (opts->speed < MTX_SPEED_MAX ? opts->speed : MTX_SPEED_MAX);
+	m->gaps = opts->gaps > 0 ? opts->gaps : MTX_TICK;
+
+	/* 2d char field. */
+	m->matrix = malloc(sizeof(int*) * h);
+	if(m->matrix)
+		m->matrix[0] = malloc(sizeof(int) * h * w);
+	m->length = malloc(sizeof(int) * w);
+	m->spaces = malloc(sizeof(int) * w);
+	m->updates = malloc(sizeof(int) * w);
+	m->due = malloc(sizeof(uint64_t) * w);
+	m->next = malloc(sizeof(int) * w);
+	m->changes = malloc(sizeof(struct mtx_change) * h * w);
+	m->stamp = calloc((size_t) h * w, sizeof(uint32_t));
+	if(!m->matrix || !m->matrix[0] || !m->length || !m->spaces ||
+	   !m->updates || !m->due || !m->next || !m->changes || !m->stamp)
+	{
+		mtx_free(m);
+		errno = ENOMEM;
+		return NULL;
+	}
+	for(i=1; i<h; i++)
+		m->matrix[i] = m->matrix[i - 1] + w;
+
+	/* Make the matrix */
+	for(i=0; i<h * w; i++)
+		m->matrix[0][i] = MTX_BLANK;
+
+	/* a gap is longer than g with a chance of (1 - 1/MTX_MUTATE)^(g+1). */
+	p = RAND_MAX + 1.0;
+	for(i=0; i<MTX_GAPS; i++)
+	{
+		p = p * (MTX_MUTATE - 1) / MTX_MUTATE;
+		m->gap_at[i] = p;
+	}
+	m->skip = -1;
+
+	for(i=0; i<w; i+=2)
+	{
+		/* Set up spaces[] array of how many spaces to skip */
+		m->spaces[i] = new_spaces(m);
+
+		/* And length of the stream */
+		m->length[i] = m->rand() % (h/2) + 3;
+
+		/* And set updates[] array for update speed, anywhere from */
+		/* a quarter to three quarters of the frames. */
+		m->updates[i] = m->period * MTX_TICK / (MTX_TICK/4 + m->rand() % (MTX_TICK/2 + 1));
+	}
+	build_wheel(m);
+
+	return m;
+}
+
+void mtx_free(struct mtx *m)
+{
+	if(m == NULL)
+		return;
+	if(m->matrix)
+		free(m->matrix[0]);
+	free(m->matrix);
+	free(m->length);
+	free(m->spaces);
+	free(m->updates);
+	free(m->due);
+	free(m->next);
+	free(m->changes);
+	free(m->stamp);
+	free(m);
+}
+
+/* old-style (real) scrolling. */
+/* returns whether anything is left in the column. */
+static int step_old(struct mtx *m, int j)
+{
+	int **matrix = m->matrix;
+	int i, y = 0, concur = 1, live = 0;
+
+	/* scroll the whole column down. */
+	for(i=m->lines-1; i>=1; i--)
+	{
+		/* the frontend moves the screen along with it. */
+		if(m->scrolled)
+			matrix[i][j] = matrix[i - 1][j];
+		else if(matrix[i][j] != matrix[i - 1][j])
+			set_cell(m, i, j, matrix[i - 1][j]);
+		/* get length of column, resetting when reaching the next. */
+		if(concur)
+		{
+			if(matrix[i][j]==MTX_BLANK)
+				concur = 0;
+			else
+			{
+				y++;
+				live = 1;
+			}
+		}
+		else
+		{
+			if(matrix[i][j]!=MTX_BLANK)
+			{
+				y=0;
+				concur = 1;
+				live = 1;
+			}
+		}
+	}
+	/* create new column. */
+	if(matrix[1][j] == MTX_BLANK)
+	{
+		/* fill gap with blanks. */
+		if(m->spaces[j]>0)
+		{
+			if(matrix[0][j] != MTX_BLANK)
+				set_cell(m, 0, j, MTX_BLANK);
+			m->spaces[j]--;
+		}
+		else
+		{
+			/* Random number to determine whether head of next collumn
+			   of chars has a white 'head' on it. */
+			if((m->rand() % 3) == 1)
+				set_cell(m, 0, j, MTX_HEAD);
+			else
+				set_cell(m, 0, j, rand_char(m));
+			m->length[j] = (m->rand() % (m->lines/2)) + 3;
+			m->spaces[j] = new_spaces(m);
+		}
+	}
+	/* fill in column. */
+	else if(y<m->length[j])
+		set_cell(m, 0, j, rand_char(m));
+	/* create gap. */
+	else if(matrix[0][j] != MTX_BLANK)
+		set_cell(m, 0, j, MTX_BLANK);
+
+	return live || matrix[0][j] != MTX_BLANK;
+}
+
+/* new-style (fake) scrolling. */
+/* returns whether anything is left in the column. */
+static int step_new(struct mtx *m, int j)
+{
+	int **matrix = m->matrix;
+	int i, k, y, z, firstcol = 0;
+
+	/* last column is done growing. */
+	if(matrix[0][j] == MTX_BLANK)
+	{
+		if(m->spaces[j] > 0)
+			m->spaces[j]--;
+		/* create new column. */
+		else
+		{
+			m->length[j] = (m->rand() % (m->lines/2)) + 3;
+			set_cell(m, 0, j, MTX_HEAD);
+			m->spaces[j] = new_spaces(m);
+		}
+	}
+	i = 0;
+	while(i < m->lines)
+	{
+		/* Skip over spaces */
+		while(i < m->lines && matrix[i][j] == MTX_BLANK)
+			i++;
+		if(i >= m->lines)
+			break;
+
+		/* Go to the end of this column */
+		z = i;
+		y = 0;
+		while(i < m->lines && matrix[i][j] != MTX_BLANK)
+		{
+			i++;
+			y++;
+		}
+
+		/* change the odd character, jumping straight from one to the */
+		/* next. the gap carries on into the next stream. */
+		if(m->flags & MTX_FLAG_CHANGES)
+		{
+			if(m->skip < 0)
+				m->skip = mutation_gap(m);
+			for(k=z+m->skip; k<i; k+=mutation_gap(m)+1)
+				set_cell(m, k, j, rand_char(m));
+			m->skip = k - i;
+		}
+
+		/* replace old head with normal char. */
+		if(i && matrix[i-1][j] == MTX_HEAD)
+			set_cell(m, i-1, j, rand_char(m));
+
+		/* create new head. */
+		if(i < m->lines)
+			set_cell(m, i, j, MTX_HEAD);
+
+		/* If we're at the top of the column and it's reached its
+		   full length (about to start moving down), we do this
+		   to get it moving.  This is also how we keep segment_sizes not
+		   already growing from growing accidentally => */
+		if(y > m->length[j] || firstcol)
+			set_cell(m, z, j, MTX_BLANK);
+		firstcol = 1;
+		i++;
+	}
+
+	return firstcol;
+}
+
+/* start a new change list. */
+static void new_changes(struct mtx *m)
+{
+	m->nchanges = 0;
+	if(++m->gen == 0)
+	{
+		memset(m->stamp, 0, sizeof(uint32_t) * m->lines * m->cols);
+		m->gen = 1;
+	}
+}
+
+void mtx_step(struct mtx *m)
+{
+	int j, list, live, period;
+
+	new_changes(m);
+
+	/* time stands still while paused. */
+	m->scrolled = 0;
+	if(m->flags & MTX_FLAG_PAUSE)
+		return;
+
+	/* every line updates every frame without -a, so start over when it's toggled. */
+	if((m->flags & MTX_FLAG_ASYNC) != m->async)
+		build_wheel(m);
+
+	/* a line with nothing in it isn't stepped, but moving it down */
+	/* wouldn't change it either, so the whole screen scrolls. */
+	if((m->flags & (MTX_FLAG_SCROLL | MTX_FLAG_OLD)) == (MTX_FLAG_SCROLL | MTX_FLAG_OLD) &&
+	   !m->async && m->period == MTX_TICK)
+		m->scrolled = 1;
+
+	/* take this frame's slot and update the lines that are due. */
+	list = m->wheel[m->tick % MTX_WHEEL];
+	m->wheel[m->tick % MTX_WHEEL] = -1;
+	while(list != -1)
+	{
+		j = list;
+		list = m->next[j];
+
+		/* due on a later turn of the wheel. */
+		if(m->due[j] / MTX_TICK > m->tick)
+		{
+			schedule(m, j);
+			continue;
+		}
+
+		/* faster than a frame, a line updates as often as it's due. */
+		do
+		{
+			if(m->flags & MTX_FLAG_OLD)
+				live = step_old(m, j);
+			else
+				live = step_new(m, j);
+
+			period = m->async ? m->updates[j] : m->period;
+			m->due[j] += period;
+
+			/* an empty column only counts down its spaces, so skip */
+			/* straight to the update that starts the next stream. */
+			if(!live && m->spaces[j] > 0)
+			{
+				m->due[j] += (uint64_t) period * m->spaces[j];
+				m->spaces[j] = 0;
+			}
+		} while(m->due[j] / MTX_TICK <= m->tick);
+		schedule(m, j);
+	}
+
+	/* next iteration. */
+	m->tick++;
+}
+
+/* mtx_fastforward() keeps a new-style line as its streams, */
+/* without the cells in between. */
+struct stream
+{
+	int top, bottom;        /* rows of its first and last cell. */
+	int head;               /* the last cell is a head. */
+};
+
+/* updates of step_new() on line j, a stream at a time. */
+static void forward_new(struct mtx *m, int j, int updates, struct stream *s)
+{
+	int **matrix = m->matrix;
+	int i, k, n = 0, kept, y;
+
+	for(i=0; i<m->lines; i++)
+	{
+		if(matrix[i][j] == MTX_BLANK)
+			continue;
+		if(!n || s[n-1].bottom != i - 1)
+		{
+			s[n].top = i;
+			n++;
+		}
+		s[n-1].bottom = i;
+		s[n-1].head = matrix[i][j] == MTX_HEAD;
+	}
+
+	while(updates-- > 0)
+	{
+		/* last column is done growing. */
+		if(!n || s[0].top > 0)
+		{
+			if(m->spaces[j] > 0)
+				m->spaces[j]--;
+			else
+			{
+				m->length[j] = (m->rand() % (m->lines/2)) + 3;
+				memmove(s + 1, s, sizeof(struct stream) * n);
+				s[0].top = s[0].bottom = 0;
+				n++;
+				m->spaces[j] = new_spaces(m);
+			}
+		}
+
+		/* each stream grows a head, and loses its top once it's long */
+		/* enough or, for all but the first, every time. */
+		kept = 0;
+		for(k=0; k<n; k++)
+		{
+			y = s[k].bottom - s[k].top + 1;
+			s[k].head = s[k].bottom + 1 < m->lines;
+			if(s[k].head)
+				s[k].bottom++;
+			if(y > m->length[j] || k)
+				s[k].top++;
+			if(s[k].top <= s[k].bottom)
+				s[kept++] = s[k];
+		}
+		n = kept;
+	}
+
+	for(i=0; i<m->lines; i++)
+		matrix[i][j] = MTX_BLANK;
+	for(k=0; k<n; k++)
+	{
+		for(i=s[k].top; i<=s[k].bottom; i++)
+			matrix[i][j] = rand_char(m);
+		if(s[k].head)
+			matrix[s[k].bottom][j] = MTX_HEAD;
+	}
+}
+
+/* updates of step_old() on line j. the line only scrolls, so it's */
+/* the new top rows, kept in a ring of lines, over the old ones. */
+static void forward_old(struct mtx *m, int j, int updates, int *ring)
+{
+	int **matrix = m->matrix;
+	int i, u, run = 0, prev = matrix[0][j], val;
+
+	/* length of the stream at the top. */
+	while(run < m->lines && matrix[run][j] != MTX_BLANK)
+		run++;
+
+	for(u=0; u<updates; u++)
+	{
+		if(prev == MTX_BLANK)
+		{
+			if(m->spaces[j] > 0)
+			{
+				val = MTX_BLANK;
+				m->spaces[j]--;
+			}
+			else
+			{
+				val = (m->rand() % 3) == 1 ? MTX_HEAD : rand_char(m);
+				m->length[j] = (m->rand() % (m->lines/2)) + 3;
+				m->spaces[j] = new_spaces(m);
+			}
+		}
+		/* step_old() counts the stream from below, and leaves out the */
+		/* cell before a gap. */
+		else if((run < m->lines - 1 ? run - 1 : m->lines - 1) < m->length[j])
+			val = rand_char(m);
+		else
+			val = MTX_BLANK;
+
+		run = val == MTX_BLANK ? 0 : run + 1;
+		ring[u % m->lines] = prev = val;
+	}
+
+	for(i=m->lines-1; i>=updates; i--)
+		matrix[i][j] = matrix[i - updates][j];
+	for(i=0; i<m->lines && i<updates; i++)
+		matrix[i][j] = ring[(updates - 1 - i) % m->lines];
+}
+
+void mtx_fastforward(struct mtx *m, int frames)
+{
+	uint64_t end;
+	void *buf;
+	int j, period, updates;
+
+	new_changes(m);
+	m->scrolled = 0;
+	if(frames < 1)
+		return;
+
+	/* streams only run into each other on the shortest lines, which are */
+	/* cheap to step the slow way. so is running short of memory. */
+	buf = m->lines >= 8 ? malloc(sizeof(struct stream) * (m->lines + 1)) : NULL;
+	if(!buf)
+	{
+		while(frames-- > 0)
+			mtx_step(m);
+		new_changes(m);
+		return;
+	}
+
+	if((m->flags & MTX_FLAG_ASYNC) != m->async)
+		build_wheel(m);
+
+	/* every update a line is due for before the end, all at once. */
+	end = (m->tick + frames) * MTX_TICK;
+	for(j=0; j<m->cols; j+=2)
+	{
+		if(m->due[j] >= end)
+			continue;
+		period = m->async ? m->updates[j] : m->period;
+		updates = (end - 1 - m->due[j]) / period + 1;
+		m->due[j] += (uint64_t) period * updates;
+		if(m->flags & MTX_FLAG_OLD)
+			forward_old(m, j, updates, buf);
+		else
+			forward_new(m, j, updates, buf);
+	}
+	free(buf);
+
+	m->tick += frames;
+	for(j=0; j<MTX_WHEEL; j++)
+		m->wheel[j] = -1;
+	for(j=0; j<m->cols; j+=2)
+		schedule(m, j);
+}
+
+const struct mtx_change *mtx_changes(const struct mtx *m, size_t *n)
+{
+	*n = m->nchanges;
+	return m->changes;
+}
+
+void mtx_show(struct mtx *m, const int *cells)
+{
+	int y, x;
+
+	new_changes(m);
+	m->scrolled = 0;
+	for(y=0; y<m->lines; y++)
+	{
+		for(x=0; x<m->cols; x+=2)
+		{
+			if(m->matrix[y][x] != cells[y * m->cols + x])
+				set_cell(m, y, x, cells[y * m->cols + x]);
+		}
+	}
+
+	/* lines that were waiting out a gap here may not be empty there. */
+	build_wheel(m);
+}
@@ -0,0 +1,221 @@
+ /**********************************************************************\
+ | mtx.h                                                                |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+/* libcmatrix: the rain simulation, without any drawing. */
+/* a frontend creates a context with mtx_init(), calls mtx_step() once */
+/* per frame and draws whatever mtx_changes() says was touched. */
+
+#ifndef MTX_H
+#define MTX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MTX_FLAG_BOLD      0x00000003
+#define MTX_FLAG_BOLD_SOME 0x00000001
+#define MTX_FLAG_BOLD_ALL  0x00000002
+#define MTX_FLAG_BOLD_NONE 0x00000003
+
+#define MTX_FLAG_SCRSAVE   0x00000004
+#define MTX_FLAG_ASYNC     0x00000008
+#define MTX_FLAG_FORCE     0x00000010
+#define MTX_FLAG_LOCK      0x00000020
+#define MTX_FLAG_MSG       0x00000040
+#define MTX_FLAG_PREALLOC  0x00000080
+#define MTX_FLAG_RAINBOW   0x00000100
+#define MTX_FLAG_LAMBDA    0x00000200
+#define MTX_FLAG_CHANGES   0x00000400
+#define MTX_FLAG_PAUSE     0x00000800
+#define MTX_FLAG_LINUX     0x00001000
+#define MTX_FLAG_XWINDOW   0x00002000
+#define MTX_FLAG_UNICODE   0x00004000
+#define MTX_FLAG_OLD       0x00008000
+#define MTX_FLAG_NOINTRO   0x00010000
+#define MTX_FLAG_STATS     0x00020000
+#define MTX_FLAG_SCROLL    0x00040000  /* the frontend can scroll, see scrolled. */
+#define MTX_FLAG_SPARSE    0x00080000  /* twice the gaps between streams. */
+
+/* update periods are fixed point, in 1/MTX_TICK frames. */
+#define MTX_TICK       256
+
+/* fastest speed, 16 times normal. faster is taken as this. */
+#define MTX_SPEED_MAX  (16 * MTX_TICK)
+
+/* frames covered by one turn of the timing wheel. a power of two. */
+#define MTX_WHEEL      64
+
+/* with MTX_FLAG_CHANGES, one in MTX_MUTATE live cells changes each update, */
+/* picked by drawing the gap to the next one rather than a draw per cell. */
+#define MTX_MUTATE     8
+#define MTX_GAPS       64       /* gaps in the table, longer ones are cut off there. */
+
+/* cell values. anything > 0 is a character. */
+#define MTX_BLANK  -1
+#define MTX_HEAD   -2
+
+struct mtx_opts
+{
+	uint32_t flags;         /* only ASYNC, OLD, CHANGES, PAUSE, SCROLL and SPARSE matter here. */
+	int randmin, randmax;   /* range of characters, min inclusive, max exclusive. */
+	int (*rand)(void);      /* random source, rand() if NULL. */
+	int speed;              /* in 1/MTX_TICK of the normal speed, 0 for normal, */
+	                        /* up to MTX_SPEED_MAX. */
+	int gaps;               /* in 1/MTX_TICK of the normal gaps between streams, 0 for normal. */
+};
+
+/* one cell touched by the last mtx_step(). */
+struct mtx_change
+{
+	int y, x;
+	int old;                /* value before the step, the new one is in matrix[y][x]. */
+};
+
+struct mtx
+{
+	int lines, cols;
+	uint32_t flags;         /* may be changed between steps. */
+	int randmin, randmax;
+	int (*rand)(void);
+	int period;             /* frames between updates without -a, in 1/MTX_TICK. */
+	int gaps;
+
+	int **matrix;           /* matrix[y][x], only even columns are used. */
+	int *length;            /* Length of cols in each line */
+	int *spaces;            /* Spaces left to fill */
+	int *updates;           /* Frames between updates on each line (-a), in 1/MTX_TICK */
+
+	/* lines are kept on a timing wheel by when they update next, */
+	/* so a step only looks at the lines that are due. */
+	uint64_t *due;          /* next update of each line, in 1/MTX_TICK frames. */
+	int *next;              /* next line in the same wheel slot, -1 ends it. */
+	int wheel[MTX_WHEEL];   /* first line due in each frame % MTX_WHEEL. */
+	uint64_t tick;          /* frames stepped so far. */
+	uint32_t async;         /* MTX_FLAG_ASYNC as it was when the wheel was built. */
+
+	/* with MTX_FLAG_SCROLL, -o without -a moves every line down a row */
+	/* each step. that's left to the frontend: the step is flagged */
+	/* as scrolled and only the new top row is in the change list. */
+	int scrolled;
+
+	int skip;               /* live cells to pass before the next -k change, -1 before -k. */
+	int gap_at[MTX_GAPS];   /* a draw below gap_at[g] is a gap longer than g. */
+
+	struct mtx_change *changes;
+	size_t nchanges;
+	uint32_t *stamp;        /* step a cell was last recorded in, to record it once. */
+	uint32_t gen;
+};
+
+/* returns NULL (with errno set) if w x h is too small or memory runs out. */
+struct mtx *mtx_init(int w, int h, const struct mtx_opts *opts);
+void mtx_free(struct mtx *m);
+
+/* advance the simulation by one frame. */
+void mtx_step(struct mtx *m);
+
+/* run frames steps at once, a line at a time and without any drawing, */
+/* to start off looking like it's been running. the change list is left */
+/* empty, so everything needs drawing after it. */
+void mtx_fastforward(struct mtx *m, int frames);
+
+/* cells changed by the last mtx_step(), each at most once. */
+/* the array belongs to m and is only valid until the next step. */
+const struct mtx_change *mtx_changes(const struct mtx *m, size_t *n);
+
+/* instead of a step, show a frame that was simulated somewhere else, */
+/* cells[y * cols + x]. the cells that differ become the change list, */
+/* and later steps carry on from it. */
+void mtx_show(struct mtx *m, const int *cells);
+
+/* a few simulations drawn over each other, layer 0 in front. */
+/* the front one runs as asked, the ones behind it are slower and sparser. */
+/* the layers are composited a tile at a time, and a tile no layer */
+/* changed in is left alone, so only what's visible comes out of it. */
+#define MTX_LAYERS_MAX   8
+#define MTX_TILE_COLS    2      /* one used column, as rain moves down them. */
+#define MTX_TILE_LINES   4
+
+struct mtx_layers
+{
+	int lines, cols;
+	uint32_t flags;         /* passed to every layer on each step. */
+	int n;
+	struct mtx *layer[MTX_LAYERS_MAX];
+
+	int **matrix;           /* what's on top, as in struct mtx. */
+	uint8_t *depth;         /* depth[y * cols + x], the layer matrix[y][x] comes from. */
+	int scrolled;           /* as in struct mtx, there's no scrolling with more layers. */
+
+	int tiles_x, tiles_y;
+	uint8_t *dirty;         /* tiles a layer changed in during this step. */
+	struct mtx_change *changes;
+	size_t nchanges;
+	int *scratch;           /* a layer's cells for mtx_layers_show(). */
+};
+
+/* with n == 1 the single layer is used as it is, with nothing to composite. */
+struct mtx_layers *mtx_layers_init(int w, int h, int n, const struct mtx_opts *opts);
+void mtx_layers_free(struct mtx_layers *l);
+void mtx_layers_step(struct mtx_layers *l);
+void mtx_layers_fastforward(struct mtx_layers *l, int frames);
+const struct mtx_change *mtx_layers_changes(const struct mtx_layers *l, size_t *n);
+
+/* as mtx_show(), with the depth of each cell. the layers behind a cell */
+/* are left empty, as nothing of them showed. */
+void mtx_layers_show(struct mtx_layers *l, const int *cells, const uint8_t *depth);
+
+/* sub-cell drawing: the simulation runs on a canvas of dots, sx by sy */
+/* of them to a terminal cell, kept as bit planes (one bit per dot) and */
+/* packed into one dot pattern per cell with table lookups, a whole */
+/* byte of a plane row at a time. */
+#define MTX_SUB_BRAILLE  1      /* 2x4 dots, U+2800 + pattern. */
+#define MTX_SUB_HALF     2      /* 1x2 dots, upper and lower half blocks. */
+
+struct mtx_sub
+{
+	int mode;
+	int cols, lines;        /* in terminal cells. */
+	int sx, sy;             /* dots per cell. */
+	int bytes;              /* per plane row. */
+	uint8_t *rain, *heads;  /* bit planes, bit d % 8 of byte d / 8 is dot column d. */
+	uint64_t lut[4][256];   /* plane row byte -> pattern bits of each cell it covers. */
+
+	uint8_t *glyph;         /* glyph[y * cols + x], the dot pattern of each cell. */
+	uint8_t *head;          /* the dots of each cell that are heads. */
+	int *changed;           /* cells the last pack changed, as y * cols + x. */
+	size_t nchanged;
+};
+
+/* the simulation for it is cols * sx * 2 wide (it uses even columns) */
+/* and lines * sy high. */
+struct mtx_sub *mtx_sub_init(int mode, int cols, int lines);
+void mtx_sub_free(struct mtx_sub *s);
+
+/* update the planes from a simulation's changes, or all of it. */
+void mtx_sub_apply(struct mtx_sub *s, int **matrix, const struct mtx_change *c, size_t n);
+void mtx_sub_load(struct mtx_sub *s, int **matrix);
+
+/* pack the planes into glyph and head, listing the cells that changed. */
+void mtx_sub_pack(struct mtx_sub *s);
+
+#endif /* MTX_H */
@@ -0,0 +1,182 @@
+ /**********************************************************************\
+ | mtxbench.c                                                           |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+/* steps libcmatrix without a terminal and reports how long it took. */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXCLUDE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "mtx.h"
+#include "perf.h"
+
+char usage[] =
+	" Usage: mtxbench -[Akoh] [-w width] [-l lines] [-L layers] [-S braille|half] [-n frames] [-W frames] [-P]\n"
+	" -A: Disable asynchronous scroll.\n"
+	" -k: Characters change while scrolling.\n"
+	" -o: Use old-style (real) scrolling.\n"
+	" -w [width]: Width of the matrix (default 200).\n"
+	" -l [lines]: Height of the matrix (default 60).\n"
+	" -L [layers]: Number of layers to step and composite (default 1).\n"
+	" -S [braille|half]: Simulate width x lines terminal cells of dots and pack them.\n"
+	" -n [frames]: Number of frames to step (default 10000).\n"
+	" -W [frames]: Fast-forward this many frames first (default 0).\n"
+	" -P: Count cycles, instructions and cache misses with perf_event_open().\n"
+	" -h: Print usage and exit.\n";
+
+int main(int argc, char *argv[])
+{
+	struct mtx_opts opts;
+	struct mtx_layers *m;
+	struct mtx_sub *sub = NULL;
+	const struct mtx_change *c;
+	int w = 200, h = 60, layers = 1, frames = 10000, warmup = 0, mode = 0, i, optchr;
+	int use_perf = 0;
+	struct perf perf;
+	size_t n, changed = 0, packed = 0;
+	double start, init, forward, elapsed, pack = 0, t;
+
+	memset(&opts, 0, sizeof(opts));
+	opts.flags = MTX_FLAG_ASYNC;
+	opts.randmin = 33;
+	opts.randmax = 123;
+
+	while((optchr = getopt(argc, argv, "AkoPhw:l:L:S:n:W:")) != -1)
+	{
+		switch(optchr)
+		{
+			case 'A': opts.flags &= ~MTX_FLAG_ASYNC; break;
+			case 'k': opts.flags |= MTX_FLAG_CHANGES; break;
+			case 'o': opts.flags |= MTX_FLAG_OLD; break;
+			case 'w': w = atoi(optarg); break;
+			case 'l': h = atoi(optarg); break;
+			case 'L': layers = atoi(optarg); break;
+			case 'S':
+				if(!strcmp(optarg, "braille"))
+					mode = MTX_SUB_BRAILLE;
+				else if(!strcmp(optarg, "half"))
+					mode = MTX_SUB_HALF;
+				else
+				{
+					printf("%s", usage);
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'n': frames = atoi(optarg); break;
+			case 'W': warmup = atoi(optarg); break;
+			case 'P': use_perf = 1; break;
+			default: printf("%s", usage); exit(optchr == 'h' ? 0 : 1);
+		}
+	}
+
+	srand(1);
+	start = now();
+	if(mode && !(sub = mtx_sub_init(mode, w, h)))
+	{
+		fprintf(stderr, "mtxbench: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	if(!(m = sub ? mtx_layers_init(w * sub->sx * 2, h * sub->sy, layers, &opts)
+	             : mtx_layers_init(w, h, layers, &opts)))
+	{
+		fprintf(stderr, "mtxbench: %s\n", strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	init = now() - start;
+
+	start = now();
+	mtx_layers_fastforward(m, warmup);
+	forward = now() - start;
+	if(sub)
+		mtx_sub_load(sub, m->matrix);
+
+	/* phase 0 is the step, 1 the packing. */
+	if(use_perf && perf_open(&perf) == -1)
+	{
+		fprintf(stderr, "mtxbench: can't count: %s\n", strerror(errno));
+		use_perf = 0;
+	}
+
+	start = now();
+	for(i=0; i<frames; i++)
+	{
+		mtx_layers_step(m);
+		if(use_perf)
+			perf_mark(&perf, 0);
+		c = mtx_layers_changes(m, &n);
+		changed += n;
+		if(sub)
+		{
+			t = now();
+			mtx_sub_apply(sub, m->matrix, c, n);
+			mtx_sub_pack(sub);
+			packed += sub->nchanged;
+			pack += now() - t;
+			if(use_perf)
+				perf_mark(&perf, 1);
+		}
+	}
+	elapsed = now() - start - pack;
+
+	printf("size:           %dx%d, %d layer%s\n", w, h, layers, layers == 1 ? "" : "s");
+	printf("frames:         %d\n", frames);
+	printf("init time:      %.3f us\n", init * 1e6);
+	if(warmup)
+		printf("warmup time:    %.3f us for %d frames\n", forward * 1e6, warmup);
+	printf("step time:      %.3f us/frame\n", elapsed * 1e6 / frames);
+	printf("changes:        %.1f cells/frame\n", (double) changed / frames);
+	if(sub)
+	{
+		printf("dots:           %dx%d\n", w * sub->sx, h * sub->sy);
+		printf("pack time:      %.3f us/frame\n", pack * 1e6 / frames);
+		printf("packed changes: %.1f cells/frame\n", (double) packed / frames);
+	}
+	for(i=0; use_perf && i<(sub ? 2 : 1); i++)
+	{
+		printf("%-16s%.0f cycles, %.0f instructions, %.0f cache misses per frame%s\n",
+		       i ? "pack counts:" : "step counts:",
+		       (double) perf.total[i][PERF_CYCLES] / frames,
+		       (double) perf.total[i][PERF_INSTRUCTIONS] / frames,
+		       (double) perf.total[i][PERF_CACHE_MISSES] / frames,
+		       perf.kernel ? "" : " (user space)");
+	}
+	if(use_perf)
+		perf_close(&perf);
+
+	mtx_layers_free(m);
+	mtx_sub_free(sub);
+	return 0;
+}
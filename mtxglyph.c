@@ -0,0 +1,238 @@
+ /**********************************************************************\
+ | mtxglyph.c                                                           |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+/* compiles a text list of glyphs into a glyph set for cmatrix --glyphs. */
+
+#define _XOPEN_SOURCE 600
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+#include <wchar.h>
+
+#ifndef EXCLUDE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "glyphs.h"
+
+char usage[] =
+	" Usage: mtxglyph [-h] -o output [list]\n"
+	" Reads the list (or stdin) and writes a glyph set for cmatrix --glyphs.\n"
+	" Each line of the list is either a glyph, which can be a few code points\n"
+	" long, or a code point range like U+30A1-U+30FA. Empty lines and lines\n"
+	" starting with # are skipped, use U+0023 for a #.\n"
+	" -o [output]: Glyph set to write.\n"
+	" -h: Print usage and exit.\n";
+
+struct mtxg_glyph *glyphs = NULL;
+uint32_t count = 0, wide = 0;
+char *name = "<stdin>";
+int line = 0;
+
+void die(char *msg)
+{
+	fprintf(stderr, "mtxglyph: %s:%d: %s\n", name, line, msg);
+	exit(EXIT_FAILURE);
+}
+
+int utf8_encode(unsigned long c, char *s)
+{
+	if(c < 0x80)
+	{
+		s[0] = c;
+		return 1;
+	}
+	if(c < 0x800)
+	{
+		s[0] = 0xC0 | (c >> 6);
+		s[1] = 0x80 | (c & 0x3F);
+		return 2;
+	}
+	if(c < 0x10000)
+	{
+		s[0] = 0xE0 | (c >> 12);
+		s[1] = 0x80 | ((c >> 6) & 0x3F);
+		s[2] = 0x80 | (c & 0x3F);
+		return 3;
+	}
+	s[0] = 0xF0 | (c >> 18);
+	s[1] = 0x80 | ((c >> 12) & 0x3F);
+	s[2] = 0x80 | ((c >> 6) & 0x3F);
+	s[3] = 0x80 | (c & 0x3F);
+	return 4;
+}
+
+/* work out the width once, here, so cmatrix never has to. */
+void add(const char *s)
+{
+	wchar_t wcs[MTXG_BYTES];
+	size_t len = strlen(s), n, i;
+	int w, width = 0;
+
+	if(len >= MTXG_BYTES)
+		die("glyph is too long");
+	if((n = mbstowcs(wcs, s, MTXG_BYTES)) == (size_t) -1)
+		die("not valid UTF-8");
+	for(i=0; i<n; i++)
+	{
+		if((w = wcwidth(wcs[i])) < 0)
+			die("glyph isn't printable");
+		width += w;
+	}
+	if(width < 1 || width > 2)
+		die("glyph has to be one or two columns wide");
+	if(count == MTXG_MAX)
+		die("too many glyphs");
+
+	if(count % 1024 == 0)
+	{
+		if(!(glyphs = realloc(glyphs, sizeof(struct mtxg_glyph) * (count + 1024))))
+			die("out of memory");
+	}
+	memset(&glyphs[count], 0, sizeof(struct mtxg_glyph));
+	glyphs[count].width = width;
+	glyphs[count].len = len;
+	memcpy(glyphs[count].bytes, s, len);
+	count++;
+	if(width == 2)
+		wide++;
+}
+
+void put16(unsigned char *p, unsigned v)
+{
+	p[0] = v & 0xFF;
+	p[1] = (v >> 8) & 0xFF;
+}
+
+void put32(unsigned char *p, unsigned long v)
+{
+	put16(p, v & 0xFFFF);
+	put16(p + 2, (v >> 16) & 0xFFFF);
+}
+
+int main(int argc, char *argv[])
+{
+	char buf[1024], s[8], *output = NULL, *p;
+	unsigned long first, last, c;
+	unsigned char header[MTXG_HEADER];
+	FILE *in = stdin, *out;
+	int optchr;
+
+	while((optchr = getopt(argc, argv, "o:h")) != -1)
+	{
+		switch(optchr)
+		{
+			case 'o': output = optarg; break;
+			default: printf("%s", usage); exit(optchr == 'h' ? 0 : 1);
+		}
+	}
+	if(!output || argc - optind > 1)
+	{
+		printf("%s", usage);
+		exit(EXIT_FAILURE);
+	}
+	if(optind < argc)
+	{
+		name = argv[optind];
+		if(!(in = fopen(name, "r")))
+		{
+			fprintf(stderr, "mtxglyph: '%s' couldn't be opened: %s\n", name, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if(!setlocale(LC_CTYPE, "C.UTF-8") && !setlocale(LC_CTYPE, "en_US.UTF-8"))
+	{
+		fprintf(stderr, "mtxglyph: failed to set a UTF-8 locale\n");
+		exit(EXIT_FAILURE);
+	}
+
+	while(fgets(buf, sizeof(buf), in))
+	{
+		line++;
+		buf[strcspn(buf, "\r\n")] = '\0';
+		if(buf[0] == '\0' || buf[0] == '#')
+			continue;
+
+		/* U+XXXX or U+XXXX-U+YYYY. */
+		if(buf[0] == 'U' && buf[1] == '+')
+		{
+			first = strtoul(buf + 2, &p, 16);
+			last = first;
+			if(p[0] == '-' && p[1] == 'U' && p[2] == '+')
+				last = strtoul(p + 3, &p, 16);
+			if(*p != '\0' || p == buf + 2 || last < first || last > 0x10FFFF)
+				die("bad code point range");
+			for(c=first; c<=last; c++)
+			{
+				/* ranges often run through holes, leave those out. */
+				s[utf8_encode(c, s)] = '\0';
+				if((c >= 0xD800 && c <= 0xDFFF) || wcwidth((wchar_t) c) < 1)
+				{
+					if(first == last)
+						die("glyph isn't printable");
+					continue;
+				}
+				add(s);
+			}
+		}
+		else
+			add(buf);
+	}
+	if(ferror(in))
+		die(strerror(errno));
+	if(!count)
+		die("no glyphs");
+
+	if(!(out = fopen(output, "wb")))
+	{
+		fprintf(stderr, "mtxglyph: '%s' couldn't be opened: %s\n", output, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+	memset(header, 0, sizeof(header));
+	memcpy(header, MTXG_MAGIC, 4);
+	put16(header + 4, MTXG_VERSION);
+	put16(header + 6, sizeof(struct mtxg_glyph));
+	put32(header + 8, count);
+	fwrite(header, 1, sizeof(header), out);
+	fwrite(glyphs, sizeof(struct mtxg_glyph), count, out);
+	if(fclose(out) == EOF)
+	{
+		fprintf(stderr, "mtxglyph: can't write '%s': %s\n", output, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	printf("%s: %u glyphs, %u of them wide\n", output, (unsigned) count, (unsigned) wide);
+	return 0;
+}
@@ -0,0 +1,653 @@
+ /**********************************************************************\
+ | mtxpty.c                                                             |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+/* runs cmatrix on a pseudo-terminal and plays its output into a small */
+/* VT100/xterm emulator, to see what the terminal actually has to chew */
+/* on: bytes and escape sequences per frame, frames per second, and */
+/* whether the screen that comes out of it makes sense. */
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <locale.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <wchar.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#ifndef EXCLUDE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_GETOPT_H
+#include <getopt.h>
+#endif
+
+#include "perf.h"
+
+#define MAX_SIZES  16
+#define MAX_PARAMS 16
+
+char usage[] =
+	" Usage: mtxpty [-ho] [-c cmatrix] [-d seconds] [-g gap] [-s COLSxLINES]... [-- cmatrix options]\n"
+	" -c [cmatrix]: cmatrix binary to run (default ./cmatrix).\n"
+	" -d [seconds]: How long to run at each size (default 5).\n"
+	" -g [gap]: Milliseconds of silence that end a frame (default 3).\n"
+	" -s [COLSxLINES]: Terminal size, can be given several times (default 80x24).\n"
+	" -o: Allow drawing in odd columns, as --subcell does.\n"
+	" -h: Print usage and exit.\n"
+	" Options after -- go to cmatrix, -u 1 if there are none. The screen check\n"
+	" expects no -M or -L message, as it flags anything drawn in odd columns.\n";
+
+int odd_columns = 0;           /* -o. */
+
+enum { GROUND, ESC, CSI, OSC, OSC_ESC, CHARSET };
+
+/* the emulated terminal. */
+struct vt
+{
+	int cols, lines;
+	uint32_t *cell;            /* one code point per cell, 0 if never written. */
+	int x, y, wrap;            /* cursor, and a wrap pending at the right margin. */
+	int top, bottom;           /* scrolling region. */
+	int sx, sy;                /* saved cursor. */
+	uint32_t last;             /* last char printed, for REP. */
+
+	int state;
+	int params[MAX_PARAMS];
+	int nparams;
+	int priv;
+	uint32_t utf;
+	int utfleft;
+
+	unsigned long seqs;        /* escape sequences seen. */
+	unsigned long unknown;     /* ones we don't understand. */
+	unsigned long clamped;     /* cursor addressed off the screen. */
+};
+
+/* how one run went. */
+struct result
+{
+	unsigned long bytes, frames;
+	double first, elapsed;     /* first output, and the whole run, in seconds. */
+	unsigned long bad, odd;    /* cells with junk, and with anything in an odd column. */
+	int status;
+};
+
+#define CELL(vt, y, x) ((vt)->cell[(size_t) (y) * (vt)->cols + (x)])
+
+static void clear_cells(struct vt *vt, int y, int x0, int x1)
+{
+	int x;
+
+	for(x=x0; x<x1; x++)
+		CELL(vt, y, x) = ' ';
+}
+
+static void clamp(struct vt *vt)
+{
+	if(vt->x < 0 || vt->x >= vt->cols || vt->y < 0 || vt->y >= vt->lines)
+		vt->clamped++;
+	if(vt->x < 0)
+		vt->x = 0;
+	if(vt->x >= vt->cols)
+		vt->x = vt->cols - 1;
+	if(vt->y < 0)
+		vt->y = 0;
+	if(vt->y >= vt->lines)
+		vt->y = vt->lines - 1;
+	vt->wrap = 0;
+}
+
+/* scroll lines top..bottom up by n, or down if n is negative. */
+static void scroll_region(struct vt *vt, int top, int bottom, int n)
+{
+	int y, rows = bottom - top + 1;
+
+	if(n > rows)
+		n = rows;
+	if(n < -rows)
+		n = -rows;
+	if(n > 0)
+	{
+		memmove(&CELL(vt, top, 0), &CELL(vt, top + n, 0), sizeof(uint32_t) * vt->cols * (rows - n));
+		for(y=bottom - n + 1; y<=bottom; y++)
+			clear_cells(vt, y, 0, vt->cols);
+	}
+	else if(n < 0)
+	{
+		n = -n;
+		memmove(&CELL(vt, top + n, 0), &CELL(vt, top, 0), sizeof(uint32_t) * vt->cols * (rows - n));
+		for(y=top; y<top + n; y++)
+			clear_cells(vt, y, 0, vt->cols);
+	}
+}
+
+static void linefeed(struct vt *vt)
+{
+	if(vt->y == vt->bottom)
+		scroll_region(vt, vt->top, vt->bottom, 1);
+	else if(vt->y < vt->lines - 1)
+		vt->y++;
+}
+
+static void reverse_index(struct vt *vt)
+{
+	if(vt->y == vt->top)
+		scroll_region(vt, vt->top, vt->bottom, -1);
+	else if(vt->y > 0)
+		vt->y--;
+}
+
+static void put(struct vt *vt, uint32_t c)
+{
+	int width = c < 0x80 ? 1 : wcwidth(c);
+
+	/* combining marks go with the char before them. */
+	if(width == 0)
+		return;
+	if(width != 2)
+		width = 1;
+
+	/* a wide char that doesn't fit wraps first. */
+	if(vt->wrap || (width == 2 && vt->x == vt->cols - 1))
+	{
+		vt->x = 0;
+		linefeed(vt);
+		vt->wrap = 0;
+	}
+	CELL(vt, vt->y, vt->x) = c;
+	if(width == 2)
+		CELL(vt, vt->y, vt->x + 1) = 0;
+	vt->last = c;
+	if(vt->x + width >= vt->cols)
+	{
+		vt->x = vt->cols - 1;
+		vt->wrap = 1;
+	}
+	else
+		vt->x += width;
+}
+
+static int param(struct vt *vt, int i, int def)
+{
+	if(i >= vt->nparams || vt->params[i] <= 0)
+		return def;
+	return vt->params[i];
+}
+
+static void csi(struct vt *vt, int c)
+{
+	int n = param(vt, 0, 1), i;
+
+	vt->seqs++;
+	/* private modes and queries don't touch the screen. */
+	if(vt->priv && c != 'h' && c != 'l' && c != 'm' && c != 'J' && c != 'K')
+		return;
+
+	switch(c)
+	{
+		case 'H': case 'f':
+			vt->y = param(vt, 0, 1) - 1;
+			vt->x = param(vt, 1, 1) - 1;
+			clamp(vt);
+			break;
+		case 'A': vt->y -= n; if(vt->y < 0) vt->y = 0; vt->wrap = 0; break;
+		case 'B': vt->y += n; if(vt->y >= vt->lines) vt->y = vt->lines - 1; vt->wrap = 0; break;
+		case 'C': vt->x += n; if(vt->x >= vt->cols) vt->x = vt->cols - 1; vt->wrap = 0; break;
+		case 'D': vt->x -= n; if(vt->x < 0) vt->x = 0; vt->wrap = 0; break;
+		case 'E': vt->y += n; vt->x = 0; if(vt->y >= vt->lines) vt->y = vt->lines - 1; vt->wrap = 0; break;
+		case 'F': vt->y -= n; vt->x = 0; if(vt->y < 0) vt->y = 0; vt->wrap = 0; break;
+		case 'G': case '`': vt->x = n - 1; clamp(vt); break;
+		case 'd': vt->y = n - 1; clamp(vt); break;
+		case 'J':
+			switch(param(vt, 0, 0))
+			{
+				case 0:
+					clear_cells(vt, vt->y, vt->x, vt->cols);
+					for(i=vt->y + 1; i<vt->lines; i++)
+						clear_cells(vt, i, 0, vt->cols);
+					break;
+				case 1:
+					clear_cells(vt, vt->y, 0, vt->x + 1);
+					for(i=0; i<vt->y; i++)
+						clear_cells(vt, i, 0, vt->cols);
+					break;
+				default:
+					for(i=0; i<vt->lines; i++)
+						clear_cells(vt, i, 0, vt->cols);
+			}
+			break;
+		case 'K':
+			switch(param(vt, 0, 0))
+			{
+				case 0: clear_cells(vt, vt->y, vt->x, vt->cols); break;
+				case 1: clear_cells(vt, vt->y, 0, vt->x + 1); break;
+				default: clear_cells(vt, vt->y, 0, vt->cols);
+			}
+			break;
+		case 'X':
+			clear_cells(vt, vt->y, vt->x, vt->x + n < vt->cols ? vt->x + n : vt->cols);
+			break;
+		case 'r':
+			vt->top = param(vt, 0, 1) - 1;
+			vt->bottom = param(vt, 1, vt->lines) - 1;
+			if(vt->top < 0 || vt->bottom >= vt->lines || vt->top >= vt->bottom)
+			{
+				vt->clamped++;
+				vt->top = 0;
+				vt->bottom = vt->lines - 1;
+			}
+			vt->x = vt->y = 0;
+			vt->wrap = 0;
+			break;
+		case 'S': scroll_region(vt, vt->top, vt->bottom, n); break;
+		case 'T': scroll_region(vt, vt->top, vt->bottom, -n); break;
+		case 'L':
+			if(vt->y >= vt->top && vt->y <= vt->bottom)
+				scroll_region(vt, vt->y, vt->bottom, -n);
+			break;
+		case 'M':
+			if(vt->y >= vt->top && vt->y <= vt->bottom)
+				scroll_region(vt, vt->y, vt->bottom, n);
+			break;
+		case '@':
+			if(n > vt->cols - vt->x)
+				n = vt->cols - vt->x;
+			memmove(&CELL(vt, vt->y, vt->x + n), &CELL(vt, vt->y, vt->x), sizeof(uint32_t) * (vt->cols - vt->x - n));
+			clear_cells(vt, vt->y, vt->x, vt->x + n);
+			break;
+		case 'P':
+			if(n > vt->cols - vt->x)
+				n = vt->cols - vt->x;
+			memmove(&CELL(vt, vt->y, vt->x), &CELL(vt, vt->y, vt->x + n), sizeof(uint32_t) * (vt->cols - vt->x - n));
+			clear_cells(vt, vt->y, vt->cols - n, vt->cols);
+			break;
+		case 'b':
+			while(n--)
+				put(vt, vt->last);
+			break;
+		case 's': vt->sx = vt->x; vt->sy = vt->y; break;
+		case 'u': vt->x = vt->sx; vt->y = vt->sy; vt->wrap = 0; break;
+		/* modes, attributes, reports and window ops. */
+		case 'h': case 'l': case 'm': case 'n': case 'c': case 't':
+			break;
+		default:
+			vt->unknown++;
+	}
+}
+
+static void esc(struct vt *vt, int c)
+{
+	vt->state = GROUND;
+	switch(c)
+	{
+		case '[':
+			vt->state = CSI;
+			vt->nparams = 0;
+			vt->params[0] = 0;
+			vt->priv = 0;
+			return;
+		case ']': vt->state = OSC; return;
+		case '(': case ')': case '*': case '+': vt->state = CHARSET; return;
+		case '7': vt->sx = vt->x; vt->sy = vt->y; break;
+		case '8': vt->x = vt->sx; vt->y = vt->sy; vt->wrap = 0; break;
+		case 'D': linefeed(vt); break;
+		case 'E': vt->x = 0; linefeed(vt); break;
+		case 'M': reverse_index(vt); break;
+		case '=': case '>': case '\\': break;
+		default: vt->unknown++;
+	}
+	vt->seqs++;
+}
+
+static void vt_feed(struct vt *vt, const unsigned char *buf, size_t len)
+{
+	size_t i;
+	int c;
+
+	for(i=0; i<len; i++)
+	{
+		c = buf[i];
+		switch(vt->state)
+		{
+			case GROUND:
+				/* utf-8 continuation. */
+				if(vt->utfleft && (c & 0xC0) == 0x80)
+				{
+					vt->utf = (vt->utf << 6) | (c & 0x3F);
+					if(--vt->utfleft == 0)
+						put(vt, vt->utf);
+					continue;
+				}
+				vt->utfleft = 0;
+				if(c == 0x1b)
+					vt->state = ESC;
+				else if(c == '\r')
+				{
+					vt->x = 0;
+					vt->wrap = 0;
+				}
+				else if(c == '\n' || c == '\v' || c == '\f')
+					linefeed(vt);
+				else if(c == '\b')
+				{
+					if(vt->x > 0)
+						vt->x--;
+					vt->wrap = 0;
+				}
+				else if(c == '\t')
+				{
+					vt->x = (vt->x + 8) & ~7;
+					if(vt->x >= vt->cols)
+						vt->x = vt->cols - 1;
+				}
+				else if(c < 0x20 || c == 0x7f)
+					;
+				else if(c < 0x80)
+					put(vt, c);
+				else if((c & 0xE0) == 0xC0)
+				{
+					vt->utf = c & 0x1F;
+					vt->utfleft = 1;
+				}
+				else if((c & 0xF0) == 0xE0)
+				{
+					vt->utf = c & 0x0F;
+					vt->utfleft = 2;
+				}
+				else if((c & 0xF8) == 0xF0)
+				{
+					vt->utf = c & 0x07;
+					vt->utfleft = 3;
+				}
+				/* stray continuation or invalid byte. */
+				else
+					put(vt, 0xFFFD);
+				break;
+			case ESC:
+				esc(vt, c);
+				break;
+			case CSI:
+				if(c >= '0' && c <= '9')
+				{
+					if(vt->nparams == 0)
+						vt->nparams = 1;
+					vt->params[vt->nparams - 1] = vt->params[vt->nparams - 1] * 10 + c - '0';
+				}
+				else if(c == ';')
+				{
+					if(vt->nparams == 0)
+						vt->nparams = 1;
+					if(vt->nparams < MAX_PARAMS)
+						vt->params[vt->nparams++] = 0;
+				}
+				else if(c == '?' || c == '>' || c == '!' || c == '=')
+					vt->priv = c;
+				else if(c >= 0x40 && c <= 0x7e)
+				{
+					csi(vt, c);
+					vt->state = GROUND;
+				}
+				/* intermediates are ignored. */
+				break;
+			case OSC:
+				if(c == 0x07)
+				{
+					vt->seqs++;
+					vt->state = GROUND;
+				}
+				else if(c == 0x1b)
+					vt->state = OSC_ESC;
+				break;
+			case OSC_ESC:
+				vt->seqs++;
+				vt->state = GROUND;
+				break;
+			case CHARSET:
+				vt->seqs++;
+				vt->state = GROUND;
+				break;
+		}
+	}
+}
+
+/* look over the screen: only printable chars, and nothing in the odd */
+/* columns, which cmatrix never draws in but with -o. the right half */
+/* of a wide char is left empty. */
+static void check_grid(struct vt *vt, struct result *res)
+{
+	int y, x;
+	uint32_t c;
+
+	for(y=0; y<vt->lines; y++)
+	{
+		for(x=0; x<vt->cols; x++)
+		{
+			c = CELL(vt, y, x);
+			if(c == 0 || c == ' ')
+				continue;
+			if(c < 0x20 || (c >= 0x7f && c < 0xa0) || c == 0xFFFD)
+				res->bad++;
+			if((x & 1) && !odd_columns)
+				res->odd++;
+		}
+	}
+}
+
+static pid_t spawn(int cols, int lines, char **argv, int *master)
+{
+	struct winsize ws;
+	pid_t pid;
+	int fd, slave;
+
+	if((fd = posix_openpt(O_RDWR | O_NOCTTY)) == -1 || grantpt(fd) == -1 || unlockpt(fd) == -1)
+		return -1;
+
+	memset(&ws, 0, sizeof(ws));
+	ws.ws_col = cols;
+	ws.ws_row = lines;
+	ioctl(fd, TIOCSWINSZ, &ws);
+
+	if((pid = fork()) == -1)
+		return -1;
+	if(pid == 0)
+	{
+		setsid();
+		if((slave = open(ptsname(fd), O_RDWR)) == -1)
+			_exit(127);
+#ifdef TIOCSCTTY
+		ioctl(slave, TIOCSCTTY, 0);
+#endif
+		dup2(slave, 0);
+		dup2(slave, 1);
+		dup2(slave, 2);
+		close(slave);
+		close(fd);
+		setenv("TERM", "xterm", 1);
+		execvp(argv[0], argv);
+		_exit(127);
+	}
+	*master = fd;
+	return pid;
+}
+
+static int run(int cols, int lines, double duration, double gap, char **argv, struct vt *vt, struct result *res)
+{
+	unsigned char buf[65536];
+	struct pollfd pfd;
+	double start, last = 0, t;
+	int fd, quit = 0, wait_ms;
+	ssize_t n;
+	pid_t pid;
+
+	memset(vt, 0, sizeof(struct vt));
+	memset(res, 0, sizeof(struct result));
+	vt->cols = cols;
+	vt->lines = lines;
+	vt->bottom = lines - 1;
+	if(!(vt->cell = calloc((size_t) cols * lines, sizeof(uint32_t))))
+		return -1;
+
+	start = now();
+	if((pid = spawn(cols, lines, argv, &fd)) == -1)
+		return -1;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	while(1)
+	{
+		t = now() - start;
+		if(!quit && t >= duration)
+		{
+			/* look at the screen before cmatrix clears it on the way out. */
+			res->elapsed = last - res->first;
+			check_grid(vt, res);
+			if(write(fd, "q", 1) != 1)
+				break;
+			quit = 1;
+		}
+		wait_ms = quit ? 1000 : (int) ((duration - t) * 1000) + 1;
+		n = poll(&pfd, 1, wait_ms);
+		if(n == 0 && !quit)
+			continue;
+		if(n <= 0)
+			break;
+		if((n = read(fd, buf, sizeof(buf))) <= 0)
+			break;
+		if(quit)
+			continue;
+
+		/* a burst of output after a quiet spell is a new frame. */
+		t = now() - start;
+		if(!res->bytes)
+			res->first = t;
+		if(!res->frames || t - last >= gap)
+			res->frames++;
+		last = t;
+		res->bytes += n;
+		vt_feed(vt, buf, n);
+	}
+
+	close(fd);
+	kill(pid, SIGTERM);
+	waitpid(pid, &res->status, 0);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	char *cmatrix = "./cmatrix", **args;
+	char *defargs[] = {"-u", "1", NULL};
+	int sizes[MAX_SIZES][2], nsizes = 0, optchr, i, nargs, failed = 0;
+	double duration = 5, gap = 0.003;
+	struct vt vt;
+	struct result res;
+
+	/* for the width of what cmatrix prints. */
+	if(!setlocale(LC_CTYPE, "C.UTF-8"))
+		setlocale(LC_CTYPE, "en_US.UTF-8");
+
+	while((optchr = getopt(argc, argv, "c:d:g:s:oh")) != -1)
+	{
+		switch(optchr)
+		{
+			case 'c': cmatrix = optarg; break;
+			case 'd': duration = atof(optarg); break;
+			case 'g': gap = atof(optarg) / 1000; break;
+			case 'o': odd_columns = 1; break;
+			case 's':
+				if(nsizes == MAX_SIZES || sscanf(optarg, "%dx%d", &sizes[nsizes][0], &sizes[nsizes][1]) != 2 ||
+				   sizes[nsizes][0] < 1 || sizes[nsizes][1] < 1)
+				{
+					fprintf(stderr, "mtxpty: bad size '%s'\n", optarg);
+					exit(EXIT_FAILURE);
+				}
+				nsizes++;
+				break;
+			default: printf("%s", usage); exit(optchr == 'h' ? 0 : 1);
+		}
+	}
+	if(!nsizes)
+	{
+		sizes[0][0] = 80;
+		sizes[0][1] = 24;
+		nsizes = 1;
+	}
+
+	/* cmatrix, then its options. */
+	nargs = argc - optind;
+	args = malloc(sizeof(char*) * (nargs + 4));
+	args[0] = cmatrix;
+	if(nargs)
+		memcpy(args + 1, argv + optind, sizeof(char*) * nargs);
+	else
+		for(nargs=0; defargs[nargs]; nargs++)
+			args[nargs + 1] = defargs[nargs];
+	args[nargs + 1] = NULL;
+
+	for(i=0; i<nsizes; i++)
+	{
+		if(run(sizes[i][0], sizes[i][1], duration, gap, args, &vt, &res) == -1)
+		{
+			fprintf(stderr, "mtxpty: can't run %s: %s\n", cmatrix, strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+		if(!res.frames)
+		{
+			printf("%dx%d: no output\n", sizes[i][0], sizes[i][1]);
+			failed = 1;
+			free(vt.cell);
+			continue;
+		}
+
+		printf("%dx%d:\n", sizes[i][0], sizes[i][1]);
+		printf("  first output:   %.3f ms\n", res.first * 1e3);
+		printf("  frames:         %lu in %.3f s (%.1f frames/s)\n", res.frames, res.elapsed,
+		       res.elapsed > 0 ? (res.frames - 1) / res.elapsed : 0);
+		printf("  bytes:          %.1f per frame (%lu total)\n", (double) res.bytes / res.frames, res.bytes);
+		printf("  sequences:      %.1f per frame (%lu total)\n", (double) vt.seqs / res.frames, vt.seqs);
+		printf("  screen:         %lu bad cells, %lu in odd columns, %lu unknown sequences, %lu off-screen moves\n",
+		       res.bad, res.odd, vt.unknown, vt.clamped);
+		if(!WIFEXITED(res.status) || WEXITSTATUS(res.status) != 0)
+		{
+			printf("  cmatrix didn't exit cleanly (status %d)\n", res.status);
+			failed = 1;
+		}
+		if(res.bad || res.odd || vt.unknown || vt.clamped)
+			failed = 1;
+		free(vt.cell);
+	}
+
+	free(args);
+	return failed ? EXIT_FAILURE : 0;
+}
@@ -0,0 +1,168 @@
+ /**********************************************************************\
+ | perf.c                                                               |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef EXCLUDE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include "perf.h"
+
+#if defined(HAVE_LINUX_PERF_EVENT_H) && defined(HAVE_UNISTD_H)
+
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+static const uint64_t events[PERF_COUNTERS] =
+{
+	PERF_COUNT_HW_CPU_CYCLES,
+	PERF_COUNT_HW_INSTRUCTIONS,
+	PERF_COUNT_HW_CACHE_MISSES,
+};
+
+static int open_group(struct perf *p, int kernel)
+{
+	struct perf_event_attr attr;
+	int i;
+
+	for(i=0; i<PERF_COUNTERS; i++)
+	{
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = events[i];
+		attr.read_format = PERF_FORMAT_GROUP;
+		attr.disabled = i == 0;
+		attr.exclude_kernel = !kernel;
+		attr.exclude_hv = 1;
+		p->fd[i] = syscall(__NR_perf_event_open, &attr, 0, -1, i ? p->fd[0] : -1, 0);
+		if(p->fd[i] == -1)
+		{
+			perf_close(p);
+			return -1;
+		}
+	}
+	p->kernel = kernel;
+	return 0;
+}
+
+/* the counters in the order they were opened. */
+static int read_group(struct perf *p, uint64_t *values)
+{
+	uint64_t buf[1 + PERF_COUNTERS];
+
+	if(read(p->fd[0], buf, sizeof(buf)) != sizeof(buf) || buf[0] != PERF_COUNTERS)
+		return -1;
+	memcpy(values, buf + 1, sizeof(uint64_t) * PERF_COUNTERS);
+	return 0;
+}
+
+int perf_open(struct perf *p)
+{
+	int i;
+
+	memset(p, 0, sizeof(struct perf));
+	for(i=0; i<PERF_COUNTERS; i++)
+		p->fd[i] = -1;
+
+	/* writing to the terminal is part of a frame too, but */
+	/* perf_event_paranoid may only allow counting user space. */
+	if(open_group(p, 1) == -1 && (errno != EACCES || open_group(p, 0) == -1))
+		return -1;
+
+	ioctl(p->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	if(read_group(p, p->last) == -1)
+	{
+		perf_close(p);
+		errno = EIO;
+		return -1;
+	}
+	return 0;
+}
+
+void perf_close(struct perf *p)
+{
+	int i;
+
+	for(i=0; i<PERF_COUNTERS; i++)
+	{
+		if(p->fd[i] != -1)
+			close(p->fd[i]);
+		p->fd[i] = -1;
+	}
+}
+
+void perf_mark(struct perf *p, int phase)
+{
+	uint64_t counts[PERF_COUNTERS];
+	int i;
+
+	if(p->fd[0] == -1 || read_group(p, counts) == -1)
+		return;
+	for(i=0; i<PERF_COUNTERS; i++)
+	{
+		if(phase >= 0)
+			p->total[phase][i] += counts[i] - p->last[i];
+		p->last[i] = counts[i];
+	}
+}
+
+#else
+
+/* no perf_event_open(), nothing to count with. */
+int perf_open(struct perf *p)
+{
+	int i;
+
+	memset(p, 0, sizeof(struct perf));
+	for(i=0; i<PERF_COUNTERS; i++)
+		p->fd[i] = -1;
+	errno = ENOSYS;
+	return -1;
+}
+
+void perf_close(struct perf *p)
+{
+}
+
+void perf_mark(struct perf *p, int phase)
+{
+}
+
+#endif
+
+double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
@@ -0,0 +1,72 @@
+ /**********************************************************************\
+ | perf.h                                                               |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+/* looking inside a frame without a debugger. */
+/* PROBE*() are USDT probes (sys/sdt.h), a nop until something like */
+/* perf, bpftrace or SystemTap attaches to them, and nothing at all */
+/* without sys/sdt.h. the perf_* functions count cycles, instructions */
+/* and cache misses with Linux perf_event_open(), split up into phases */
+/* of the caller's choosing. */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#define PROBE(name)          DTRACE_PROBE(cmatrix, name)
+#define PROBE1(name, a)      DTRACE_PROBE1(cmatrix, name, a)
+#define PROBE2(name, a, b)   DTRACE_PROBE2(cmatrix, name, a, b)
+#else
+#define PROBE(name)          do { } while(0)
+#define PROBE1(name, a)      do { } while(0)
+#define PROBE2(name, a, b)   do { } while(0)
+#endif
+
+#define PERF_CYCLES        0
+#define PERF_INSTRUCTIONS  1
+#define PERF_CACHE_MISSES  2
+#define PERF_COUNTERS      3
+#define PERF_PHASES        4
+
+struct perf
+{
+	int fd[PERF_COUNTERS];          /* fd[0] leads the group, -1 when closed. */
+	int kernel;                     /* counting the kernel's part too. */
+	uint64_t last[PERF_COUNTERS];
+	uint64_t total[PERF_PHASES][PERF_COUNTERS];
+};
+
+/* 0 and counting, or -1 with errno set (ENOSYS without perf_event_open). */
+int perf_open(struct perf *p);
+void perf_close(struct perf *p);
+
+/* what was counted since the last mark goes to phase, or nowhere if */
+/* phase is -1. */
+void perf_mark(struct perf *p, int phase);
+
+/* seconds on the monotonic clock. */
+double now(void);
+
+#endif /* PERF_H */
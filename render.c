@@ -0,0 +1,665 @@
+ /**********************************************************************\
+ | render.c                                                             |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef EXCLUDE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#ifdef HAVE_ZLIB_H
+#include <zlib.h>
+#endif
+
+#include "perf.h"
+#include "render.h"
+
+/* the blitting threads hand out work a tile at a time, sized in cells. */
+#define TILE_COLS  16
+#define TILE_LINES 4
+
+#define FONT_SIZE_MAX (1 << 22)
+#define MAX_THREADS   64
+
+/* where to look for the font if none is given. */
+static const char *font_paths[] =
+{
+	"matrix.psf.gz",
+	"matrix.fnt",
+	"/usr/local/share/consolefonts/matrix.psf.gz",
+	"/usr/local/share/kbd/consolefonts/matrix.psf.gz",
+	"/usr/share/consolefonts/matrix.psf.gz",
+	"/usr/share/kbd/consolefonts/matrix.psf.gz",
+	NULL
+};
+
+/* xterm's colours by COLOR_* number, then the bright ones used for bold. */
+static const unsigned char palette[16][3] =
+{
+	{  0,   0,   0}, {205,   0,   0}, {  0, 205,   0}, {205, 205,   0},
+	{  0,   0, 238}, {205,   0, 205}, {  0, 205, 205}, {229, 229, 229},
+	{127, 127, 127}, {255,   0,   0}, {  0, 255,   0}, {255, 255,   0},
+	{ 92,  92, 255}, {255,   0, 255}, {  0, 255, 255}, {255, 255, 255}
+};
+
+/* rainbow mode colours by column: green, red, blue, yellow, cyan, magenta. */
+static const int rainbow[6] = {2, 1, 4, 3, 6, 5};
+
+/* what's drawn in a cell, 0 for nothing. */
+#define PAINT(glyph, pal, bold) ((((uint32_t) (glyph) + 1) << 8) | ((bold) << 4) | (pal))
+#define PAINT_GLYPH(p)          (((p) >> 8) - 1)
+#define PAINT_BOLD(p)           (((p) >> 4) & 1)
+#define PAINT_PAL(p)            ((p) & 15)
+
+struct render
+{
+	const struct render_opts *o;
+	struct mtx *m;
+	struct mtx_font font;
+
+	int width, height;       /* in pixels. */
+	int cwidth, cheight;     /* of the chroma planes. */
+	int y4m;
+	unsigned char *rgb;
+	unsigned char *yuv;      /* y plane, then the u and v planes. */
+
+	uint32_t *paint;         /* what's on each cell of the frame. */
+	int tiles_x, tiles_y;
+	int *dirty;              /* tiles to draw this frame. */
+	int ndirty;
+	unsigned char *marked;   /* tile is already in dirty. */
+
+	int nthreads;
+#ifdef HAVE_PTHREAD_H
+	pthread_t threads[MAX_THREADS];
+	pthread_mutex_t lock;
+	pthread_cond_t go, done;
+	int generation;          /* bumped for every frame. */
+	int next;                /* next entry of dirty to hand out. */
+	int busy;                /* workers not done with this frame yet. */
+	int quit;
+#endif
+};
+
+/* read a whole (possibly gzipped) file. */
+static unsigned char *read_file(const char *path, size_t *len)
+{
+	unsigned char *buf;
+	size_t size = 0;
+	int n;
+#ifdef HAVE_ZLIB_H
+	gzFile f;
+
+	/* gzread() passes uncompressed files through as they are. */
+	if(!(f = gzopen(path, "rb")))
+		return NULL;
+#else
+	FILE *f;
+
+	if(!(f = fopen(path, "rb")))
+		return NULL;
+#endif
+
+	if(!(buf = malloc(FONT_SIZE_MAX)))
+	{
+#ifdef HAVE_ZLIB_H
+		gzclose(f);
+#else
+		fclose(f);
+#endif
+		errno = ENOMEM;
+		return NULL;
+	}
+
+#ifdef HAVE_ZLIB_H
+	while(size < FONT_SIZE_MAX && (n = gzread(f, buf + size, FONT_SIZE_MAX - size)) > 0)
+		size += n;
+	gzclose(f);
+#else
+	while(size < FONT_SIZE_MAX && (n = fread(buf + size, 1, FONT_SIZE_MAX - size, f)) > 0)
+		size += n;
+	fclose(f);
+
+	/* can't do anything with these without zlib. */
+	if(size >= 2 && buf[0] == 0x1f && buf[1] == 0x8b)
+		size = 0;
+#endif
+
+	if(size == 0 || size == FONT_SIZE_MAX)
+	{
+		free(buf);
+		errno = EINVAL;
+		return NULL;
+	}
+	*len = size;
+	return buf;
+}
+
+static uint32_t le32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+int font_load(struct mtx_font *f, const char *path)
+{
+	unsigned char *buf;
+	size_t len, off, size;
+
+	if(!(buf = read_file(path, &len)))
+		return -1;
+
+	memset(f, 0, sizeof(struct mtx_font));
+	off = 0;
+	/* PSF1, as used by the linux console. */
+	if(len >= 4 && buf[0] == 0x36 && buf[1] == 0x04)
+	{
+		f->width = 8;
+		f->height = buf[3];
+		f->count = (buf[2] & 1) ? 512 : 256;
+		off = 4;
+	}
+	/* PSF2. */
+	else if(len >= 32 && buf[0] == 0x72 && buf[1] == 0xb5 && buf[2] == 0x4a && buf[3] == 0x86)
+	{
+		off = le32(buf + 8);
+		f->count = le32(buf + 16);
+		f->height = le32(buf + 24);
+		f->width = le32(buf + 28);
+		if(le32(buf + 20) != (uint32_t) ((f->width + 7) / 8 * f->height))
+			f->width = 0;
+	}
+	/* raw 8xN font like matrix.fnt. */
+	else if(len % 256 == 0 && len / 256 <= 32)
+	{
+		f->width = 8;
+		f->height = len / 256;
+		f->count = 256;
+	}
+
+	f->stride = (f->width + 7) / 8;
+	size = (size_t) f->count * f->stride * f->height;
+	if(f->width < 1 || f->width > 32 || f->height < 1 || f->height > 64 ||
+	   f->count < 1 || f->count > 65536 || off > len || size > len - off)
+	{
+		free(buf);
+		errno = EINVAL;
+		return -1;
+	}
+
+	if(!(f->glyphs = malloc(size)))
+	{
+		free(buf);
+		errno = ENOMEM;
+		return -1;
+	}
+	memcpy(f->glyphs, buf + off, size);
+	free(buf);
+	return 0;
+}
+
+void font_free(struct mtx_font *f)
+{
+	free(f->glyphs);
+	f->glyphs = NULL;
+}
+
+/* work out what goes in every cell and which tiles that changes. */
+static void paint_cells(struct render *r)
+{
+	struct mtx *m = r->m;
+	uint32_t p, flags = m->flags;
+	int y, x, c, color, bold, k, t;
+
+	r->ndirty = 0;
+	memset(r->marked, 0, r->tiles_x * r->tiles_y);
+
+	for(y=0; y<m->lines; y++)
+	{
+		for(x=0; x<m->cols; x+=2)
+		{
+			c = m->matrix[y][x];
+			/* heads get a new char every frame, like on a terminal. */
+			if(c == MTX_HEAD)
+			{
+				bold = (flags & MTX_FLAG_BOLD) != 0;
+				c = (m->rand() % (m->randmax - m->randmin)) + m->randmin;
+				p = PAINT(c % r->font.count, 7 + bold * 8, bold);
+			}
+			else if(c > 0)
+			{
+				color = (flags & MTX_FLAG_RAINBOW) ? rainbow[(x>>1) % 6] : r->o->color;
+				bold = ((flags & MTX_FLAG_BOLD) == MTX_FLAG_BOLD_ALL) ||
+				       (((flags & MTX_FLAG_BOLD) == MTX_FLAG_BOLD_SOME) && (c & 1));
+				p = PAINT(c % r->font.count, color + bold * 8, bold);
+			}
+			else
+				p = 0;
+
+			k = y * m->cols + x;
+			if(r->paint[k] != p)
+			{
+				r->paint[k] = p;
+				t = (y / TILE_LINES) * r->tiles_x + x / TILE_COLS;
+				if(!r->marked[t])
+				{
+					r->marked[t] = 1;
+					r->dirty[r->ndirty++] = t;
+				}
+			}
+		}
+	}
+}
+
+static void draw_cell(struct render *r, int y, int x)
+{
+	const struct mtx_font *f = &r->font;
+	uint32_t p = r->paint[y * r->m->cols + x];
+	unsigned char *px = r->rgb + ((size_t) y * f->height * r->width + x * f->width) * 3;
+	const unsigned char *glyph, *fg;
+	uint32_t bits, top = 1u << (f->stride * 8 - 1);
+	int i, b, s;
+
+	if(!p)
+	{
+		for(i=0; i<f->height; i++, px += r->width * 3)
+			memset(px, 0, f->width * 3);
+		return;
+	}
+
+	glyph = f->glyphs + (size_t) PAINT_GLYPH(p) * f->stride * f->height;
+	fg = palette[PAINT_PAL(p)];
+	for(i=0; i<f->height; i++, px += r->width * 3)
+	{
+		bits = 0;
+		for(s=0; s<f->stride; s++)
+			bits = (bits << 8) | *glyph++;
+		/* the console way of doing bold. */
+		if(PAINT_BOLD(p))
+			bits |= bits >> 1;
+		for(b=0; b<f->width; b++)
+		{
+			if(bits & (top >> b))
+				memcpy(px + b * 3, fg, 3);
+			else
+				memset(px + b * 3, 0, 3);
+		}
+	}
+}
+
+/* rgb to 4:2:0 jpeg range yuv for the pixels x0 <= x < x1, y0 <= y < y1. */
+/* x0 and y0 are even. */
+static void convert_area(struct render *r, int x0, int y0, int x1, int y1)
+{
+	unsigned char *yp = r->yuv, *up, *vp, *s;
+	int x, y, dx, dy, n, R, G, B;
+
+	up = yp + (size_t) r->width * r->height;
+	vp = up + (size_t) r->cwidth * r->cheight;
+
+	for(y=y0; y<y1; y++)
+	{
+		s = r->rgb + ((size_t) y * r->width + x0) * 3;
+		for(x=x0; x<x1; x++, s += 3)
+			yp[(size_t) y * r->width + x] = (77 * s[0] + 150 * s[1] + 29 * s[2]) >> 8;
+	}
+
+	for(y=y0; y<y1; y+=2)
+	{
+		for(x=x0; x<x1; x+=2)
+		{
+			R = G = B = n = 0;
+			for(dy=0; dy<2 && y + dy < y1; dy++)
+			{
+				for(dx=0; dx<2 && x + dx < x1; dx++)
+				{
+					s = r->rgb + ((size_t) (y + dy) * r->width + x + dx) * 3;
+					R += s[0];
+					G += s[1];
+					B += s[2];
+					n++;
+				}
+			}
+			R /= n;
+			G /= n;
+			B /= n;
+			up[(size_t) (y/2) * r->cwidth + x/2] = ((-43 * R - 85 * G + 128 * B) >> 8) + 128;
+			vp[(size_t) (y/2) * r->cwidth + x/2] = ((128 * R - 107 * G - 21 * B) >> 8) + 128;
+		}
+	}
+}
+
+static void draw_tile(struct render *r, int t)
+{
+	int x0, y0, x1, y1, x, y;
+
+	x0 = (t % r->tiles_x) * TILE_COLS;
+	y0 = (t / r->tiles_x) * TILE_LINES;
+	x1 = x0 + TILE_COLS < r->m->cols ? x0 + TILE_COLS : r->m->cols;
+	y1 = y0 + TILE_LINES < r->m->lines ? y0 + TILE_LINES : r->m->lines;
+
+	for(y=y0; y<y1; y++)
+		for(x=x0; x<x1; x++)
+			draw_cell(r, y, x);
+
+	if(r->y4m)
+		convert_area(r, x0 * r->font.width, y0 * r->font.height,
+		             x1 * r->font.width, y1 * r->font.height);
+}
+
+#ifdef HAVE_PTHREAD_H
+/* draw tiles until there are none left. called with the lock held. */
+static void take_tiles(struct render *r)
+{
+	int t;
+
+	while(r->next < r->ndirty)
+	{
+		t = r->dirty[r->next++];
+		pthread_mutex_unlock(&r->lock);
+		draw_tile(r, t);
+		pthread_mutex_lock(&r->lock);
+	}
+}
+
+static void *worker(void *arg)
+{
+	struct render *r = arg;
+	int seen = 0;
+
+	pthread_mutex_lock(&r->lock);
+	while(1)
+	{
+		while(r->generation == seen && !r->quit)
+			pthread_cond_wait(&r->go, &r->lock);
+		if(r->quit)
+			break;
+		seen = r->generation;
+		take_tiles(r);
+		if(--r->busy == 0)
+			pthread_cond_signal(&r->done);
+	}
+	pthread_mutex_unlock(&r->lock);
+	return NULL;
+}
+#endif
+
+/* draw this frame's dirty tiles, spread over the threads. */
+static void draw_tiles(struct render *r)
+{
+	int i;
+
+#ifdef HAVE_PTHREAD_H
+	if(r->nthreads > 1)
+	{
+		pthread_mutex_lock(&r->lock);
+		r->next = 0;
+		r->busy = r->nthreads - 1;
+		r->generation++;
+		pthread_cond_broadcast(&r->go);
+		take_tiles(r);
+		while(r->busy)
+			pthread_cond_wait(&r->done, &r->lock);
+		pthread_mutex_unlock(&r->lock);
+		return;
+	}
+#endif
+	for(i=0; i<r->ndirty; i++)
+		draw_tile(r, r->dirty[i]);
+}
+
+static int write_frame(struct render *r, FILE *out, int n)
+{
+	FILE *f;
+	char name[4096];
+
+	if(r->y4m)
+	{
+		fputs("FRAME\n", out);
+		fwrite(r->yuv, 1, (size_t) r->width * r->height + (size_t) 2 * r->cwidth * r->cheight, out);
+		return ferror(out) ? -1 : 0;
+	}
+
+	snprintf(name, sizeof(name), r->o->output, n);
+	if(!(f = fopen(name, "wb")))
+		return -1;
+	fprintf(f, "P6\n%d %d\n255\n", r->width, r->height);
+	fwrite(r->rgb, 3, (size_t) r->width * r->height, f);
+	if(fclose(f) == EOF)
+		return -1;
+	return 0;
+}
+
+static void render_free(struct render *r)
+{
+#ifdef HAVE_PTHREAD_H
+	int i;
+
+	if(r->nthreads > 1)
+	{
+		pthread_mutex_lock(&r->lock);
+		r->quit = 1;
+		pthread_cond_broadcast(&r->go);
+		pthread_mutex_unlock(&r->lock);
+		for(i=1; i<r->nthreads; i++)
+			pthread_join(r->threads[i], NULL);
+		pthread_mutex_destroy(&r->lock);
+		pthread_cond_destroy(&r->go);
+		pthread_cond_destroy(&r->done);
+	}
+#endif
+	mtx_free(r->m);
+	font_free(&r->font);
+	free(r->rgb);
+	free(r->yuv);
+	free(r->paint);
+	free(r->dirty);
+	free(r->marked);
+}
+
+/* the ppm pattern goes to snprintf() with just the frame number, so it */
+/* has to have exactly one integer conversion, and no other but %%. */
+static int check_pattern(const char *p)
+{
+	int n = 0;
+
+	while((p = strchr(p, '%')))
+	{
+		p++;
+		if(*p == '%')
+		{
+			p++;
+			continue;
+		}
+		p += strspn(p, "-+ #0");
+		p += strspn(p, "0123456789");
+		if(*p == '.')
+		{
+			p++;
+			p += strspn(p, "0123456789");
+		}
+		if(!*p || !strchr("diouxX", *p))
+			return -1;
+		p++;
+		n++;
+	}
+	return n == 1 ? 0 : -1;
+}
+
+int render_video(const struct render_opts *o)
+{
+	struct render r;
+	FILE *out = NULL;
+	int i, ret = -1;
+	double start;
+
+	memset(&r, 0, sizeof(struct render));
+	r.o = o;
+
+	if(strchr(o->output, '%') && check_pattern(o->output) == -1)
+	{
+		fprintf(stderr, "cmatrix: '%s' should have one %%d (like frame%%04d.ppm) for the frame number\n", o->output);
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* find a font. */
+	if(o->font)
+	{
+		if(font_load(&r.font, o->font) == -1)
+		{
+			fprintf(stderr, "cmatrix: can't load font '%s': %s\n", o->font, strerror(errno));
+			return -1;
+		}
+	}
+	else
+	{
+		for(i=0; font_paths[i]; i++)
+			if(font_load(&r.font, font_paths[i]) == 0)
+				break;
+		if(!font_paths[i])
+		{
+			fprintf(stderr, "cmatrix: can't find matrix.psf.gz, use --font to point at it\n");
+			return -1;
+		}
+	}
+
+	if(!(r.m = mtx_init(o->cols, o->lines, &o->sim)))
+	{
+		fprintf(stderr, "cmatrix: can't start a %dx%d matrix: %s\n", o->cols, o->lines, strerror(errno));
+		font_free(&r.font);
+		return -1;
+	}
+
+	r.width = o->cols * r.font.width;
+	r.height = o->lines * r.font.height;
+	r.cwidth = (r.width + 1) / 2;
+	r.cheight = (r.height + 1) / 2;
+	r.y4m = !strchr(o->output, '%');
+	r.tiles_x = (o->cols + TILE_COLS - 1) / TILE_COLS;
+	r.tiles_y = (o->lines + TILE_LINES - 1) / TILE_LINES;
+
+	r.rgb = calloc((size_t) r.width * r.height, 3);
+	r.paint = calloc((size_t) o->cols * o->lines, sizeof(uint32_t));
+	r.dirty = malloc(sizeof(int) * r.tiles_x * r.tiles_y);
+	r.marked = malloc(r.tiles_x * r.tiles_y);
+	if(r.y4m)
+	{
+		/* black is y 0 and u, v 128. */
+		r.yuv = malloc((size_t) r.width * r.height + (size_t) 2 * r.cwidth * r.cheight);
+		if(r.yuv)
+		{
+			memset(r.yuv, 0, (size_t) r.width * r.height);
+			memset(r.yuv + (size_t) r.width * r.height, 128, (size_t) 2 * r.cwidth * r.cheight);
+		}
+	}
+	if(!r.rgb || !r.paint || !r.dirty || !r.marked || (r.y4m && !r.yuv))
+	{
+		fprintf(stderr, "cmatrix: malloc: out of memory!\n");
+		goto done;
+	}
+
+	/* open the output. */
+	if(r.y4m)
+	{
+		if(!strcmp(o->output, "-"))
+			out = stdout;
+		else if(!(out = fopen(o->output, "wb")))
+		{
+			fprintf(stderr, "cmatrix: '%s' couldn't be opened: %s\n", o->output, strerror(errno));
+			goto done;
+		}
+		fprintf(out, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", r.width, r.height, o->fps);
+	}
+
+	/* start the blitting threads, this one counts as the first. */
+	r.nthreads = o->threads;
+#ifdef HAVE_PTHREAD_H
+	if(r.nthreads < 1)
+	{
+#ifdef _SC_NPROCESSORS_ONLN
+		r.nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	}
+	if(r.nthreads > r.tiles_x * r.tiles_y)
+		r.nthreads = r.tiles_x * r.tiles_y;
+	if(r.nthreads > MAX_THREADS)
+		r.nthreads = MAX_THREADS;
+	if(r.nthreads > 1)
+	{
+		pthread_mutex_init(&r.lock, NULL);
+		pthread_cond_init(&r.go, NULL);
+		pthread_cond_init(&r.done, NULL);
+		for(i=1; i<r.nthreads; i++)
+		{
+			if(pthread_create(&r.threads[i], NULL, worker, &r))
+			{
+				/* make do with the ones that started. */
+				r.nthreads = i;
+				break;
+			}
+		}
+	}
+#endif
+	if(r.nthreads < 1)
+		r.nthreads = 1;
+
+	start = now();
+	for(i=0; i<o->frames; i++)
+	{
+		mtx_step(r.m);
+		paint_cells(&r);
+		draw_tiles(&r);
+		if(write_frame(&r, out, i) == -1)
+		{
+			fprintf(stderr, "cmatrix: can't write frame %d: %s\n", i, strerror(errno));
+			goto done;
+		}
+	}
+	if(out && fflush(out) == EOF)
+	{
+		fprintf(stderr, "cmatrix: can't write '%s': %s\n", o->output, strerror(errno));
+		goto done;
+	}
+
+	fprintf(stderr, "cmatrix: rendered %d frames of %dx%d with %d thread%s in %.3f s (%.1f frames/s)\n",
+	        o->frames, r.width, r.height, r.nthreads, r.nthreads == 1 ? "" : "s",
+	        now() - start, o->frames / (now() - start));
+	ret = 0;
+
+done:
+	if(out && out != stdout)
+		fclose(out);
+	render_free(&r);
+	return ret;
+}
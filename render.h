@@ -0,0 +1,60 @@
+ /**********************************************************************\
+ | render.h                                                             |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+/* --render-video: draws the matrix with a console font into frames */
+/* instead of onto a terminal. */
+
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "mtx.h"
+
+/* a bitmap console font. each glyph is height rows of stride bytes. */
+struct mtx_font
+{
+	int width, height, stride;
+	int count;
+	unsigned char *glyphs;
+};
+
+struct render_opts
+{
+	const char *output;     /* a .y4m file, "-" for y4m on stdout, or a printf */
+	                        /* pattern with one %d, like "frame%04d.ppm", for a ppm sequence. */
+	const char *font;       /* PSF1, PSF2 or raw 8xN font, NULL to search for matrix.psf.gz. */
+	int cols, lines;        /* size in cells. */
+	int frames;
+	int fps;                /* only written to the y4m header, frames are rendered as fast as possible. */
+	int threads;            /* 0 for one per cpu. */
+	int color;              /* COLOR_* number of the rain. */
+	struct mtx_opts sim;    /* simulation, plus the bold and rainbow flags. */
+};
+
+/* 0 on success, -1 if the font or the output didn't work out (with errno set). */
+int font_load(struct mtx_font *f, const char *path);
+void font_free(struct mtx_font *f);
+
+/* renders the whole video. complains on stderr and returns -1 on failure. */
+int render_video(const struct render_opts *o);
+
+#endif /* RENDER_H */
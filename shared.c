@@ -0,0 +1,336 @@
+ /**********************************************************************\
+ | shared.c                                                             |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifndef EXCLUDE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#include "shared.h"
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SHM_OPEN) && defined(HAVE_UNISTD_H)
+
+#define SHARED_MAGIC   0x4d545853
+#define SHARED_VERSION 1
+#define SHARED_SLOTS   4         /* readers copy one slot while the next is written. */
+#define SHARED_HEADER  64
+
+/* fcntl() locks on the segment. the publisher holds a write lock on */
+/* one byte, and everyone a read lock on another, so the last one out */
+/* can tell and remove the segment. */
+#define LOCK_PUBLISHER 0
+#define LOCK_USERS     1
+
+#if defined(__GNUC__)
+#define barrier() __sync_synchronize()
+#else
+#define barrier()
+#endif
+
+struct shared_header
+{
+	uint32_t magic, version;
+	struct shared_key key;
+	volatile uint64_t frame;    /* newest complete frame, 0 before the first. */
+};
+
+/* after the header come the slots, frame f in slot f % SHARED_SLOTS: */
+/* the frame number (0 while it's being written), the cells as ints */
+/* and the depth of each cell. */
+struct shared_slot
+{
+	volatile uint64_t frame;
+};
+
+struct shared
+{
+	struct shared_key key;
+	char name[64];
+	int fd;
+	int publishing;
+	unsigned char *map;
+	size_t size, slot_size, ncells;
+	uint64_t last;              /* newest frame shown or published. */
+	int *cells;                 /* a copy of a slot, checked before it's shown. */
+	uint8_t *depth;
+};
+
+static int lock(int fd, short type, off_t byte)
+{
+	struct flock fl;
+
+	memset(&fl, 0, sizeof(fl));
+	fl.l_type = type;
+	fl.l_whence = SEEK_SET;
+	fl.l_start = byte;
+	fl.l_len = 1;
+	return fcntl(fd, F_SETLK, &fl);
+}
+
+static struct shared_slot *slot(struct shared *s, uint64_t frame)
+{
+	return (struct shared_slot*) (s->map + SHARED_HEADER + (frame % SHARED_SLOTS) * s->slot_size);
+}
+
+/* map the segment once it has been made big enough by a publisher. */
+static int map(struct shared *s)
+{
+	struct stat st;
+	void *p;
+
+	if(s->map)
+		return 1;
+	if(!s->publishing && (fstat(s->fd, &st) == -1 || (size_t) st.st_size != s->size))
+		return 0;
+	if((p = mmap(NULL, s->size, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0)) == MAP_FAILED)
+		return 0;
+	s->map = p;
+	return 1;
+}
+
+static int header_ok(struct shared *s)
+{
+	struct shared_header *h = (struct shared_header*) s->map;
+
+	return h->magic == SHARED_MAGIC && h->version == SHARED_VERSION &&
+	       !memcmp(&h->key, &s->key, sizeof(struct shared_key));
+}
+
+/* show the publisher's newest frame in l, if there's one we haven't. */
+static int read_frame(struct shared *s, struct mtx_layers *l)
+{
+	struct shared_header *h;
+	struct shared_slot *sl;
+	uint64_t f;
+	size_t i;
+	int c;
+
+	if(!map(s) || !header_ok(s))
+		return 0;
+	h = (struct shared_header*) s->map;
+	f = h->frame;
+	barrier();
+	if(f == 0 || f == s->last)
+		return 0;
+
+	/* the slot may be written again while it's copied, it's only */
+	/* good if its frame number is the same before and after. */
+	sl = slot(s, f);
+	if(sl->frame != f)
+		return 0;
+	barrier();
+	memcpy(s->cells, (unsigned char*) sl + sizeof(uint64_t), sizeof(int) * s->ncells);
+	memcpy(s->depth, (unsigned char*) sl + sizeof(uint64_t) + sizeof(int) * s->ncells, s->ncells);
+	barrier();
+	if(sl->frame != f)
+		return 0;
+
+	/* the frontend indexes tables with these. */
+	for(i=0; i<s->ncells; i++)
+	{
+		c = s->cells[i];
+		if((c != MTX_BLANK && c != MTX_HEAD && (c < s->key.randmin || c >= s->key.randmax)) ||
+		   s->depth[i] >= s->key.layers)
+			return 0;
+	}
+
+	s->last = f;
+	mtx_layers_show(l, s->cells, s->depth);
+	return 1;
+}
+
+/* become the publisher if there's none, carrying on from its last frame. */
+static int take_over(struct shared *s, struct mtx_layers *l)
+{
+	struct shared_header *h;
+
+	if(lock(s->fd, F_WRLCK, LOCK_PUBLISHER) == -1)
+		return 0;
+	s->publishing = 1;
+	if(ftruncate(s->fd, s->size) == -1 || !map(s))
+	{
+		/* keep the lock, so nobody else fails the same way. */
+		return 1;
+	}
+
+	h = (struct shared_header*) s->map;
+	if(header_ok(s))
+		read_frame(s, l);
+	else
+	{
+		memset(s->map, 0, s->size);
+		h->version = SHARED_VERSION;
+		h->key = s->key;
+		barrier();
+		h->magic = SHARED_MAGIC;
+	}
+	return 1;
+}
+
+static void publish(struct shared *s, struct mtx_layers *l)
+{
+	struct shared_header *h = (struct shared_header*) s->map;
+	struct shared_slot *sl;
+	uint64_t f;
+
+	if(!s->map)
+		return;
+	f = h->frame + 1;
+	sl = slot(s, f);
+	sl->frame = 0;
+	barrier();
+	memcpy((unsigned char*) sl + sizeof(uint64_t), l->matrix[0], sizeof(int) * s->ncells);
+	memcpy((unsigned char*) sl + sizeof(uint64_t) + sizeof(int) * s->ncells, l->depth, s->ncells);
+	barrier();
+	sl->frame = f;
+	barrier();
+	h->frame = f;
+	s->last = f;
+}
+
+struct shared *shared_open(const struct shared_key *key)
+{
+	struct shared *s;
+	struct stat st;
+	uint32_t hash = 2166136261u;
+	const unsigned char *p = (const unsigned char*) key;
+	size_t i;
+	int err;
+
+	if(!(s = calloc(1, sizeof(struct shared))))
+		return NULL;
+	s->fd = -1;
+	s->key = *key;
+	s->ncells = (size_t) key->cols * key->lines;
+	s->slot_size = (sizeof(uint64_t) + (sizeof(int) + 1) * s->ncells + 7) & ~(size_t) 7;
+	s->size = SHARED_HEADER + SHARED_SLOTS * s->slot_size;
+	s->cells = malloc(sizeof(int) * s->ncells);
+	s->depth = malloc(s->ncells);
+	if(!s->cells || !s->depth)
+	{
+		shared_close(s);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	/* the size is in the name for people looking in /dev/shm, the rest is hashed. */
+	for(i=0; i<sizeof(struct shared_key); i++)
+		hash = (hash ^ p[i]) * 16777619u;
+	snprintf(s->name, sizeof(s->name), "/cmatrix-%lu-%dx%d-%08lx", (unsigned long) getuid(),
+	         (int) key->cols, (int) key->lines, (unsigned long) hash);
+
+	if((s->fd = shm_open(s->name, O_RDWR | O_CREAT, 0600)) == -1)
+	{
+		err = errno;
+		shared_close(s);
+		errno = err;
+		return NULL;
+	}
+
+	/* don't draw anything someone else could have written. */
+	if(fstat(s->fd, &st) == -1 || st.st_uid != getuid() || (st.st_mode & 077))
+	{
+		shared_close(s);
+		errno = EPERM;
+		return NULL;
+	}
+	lock(s->fd, F_RDLCK, LOCK_USERS);
+	return s;
+}
+
+void shared_close(struct shared *s)
+{
+	if(s == NULL)
+		return;
+	if(s->map)
+		munmap(s->map, s->size);
+	if(s->fd != -1)
+	{
+		/* last one out removes it. */
+		if(lock(s->fd, F_WRLCK, LOCK_USERS) == 0)
+			shm_unlink(s->name);
+		close(s->fd);
+	}
+	free(s->cells);
+	free(s->depth);
+	free(s);
+}
+
+int shared_step(struct shared *s, struct mtx_layers *l)
+{
+	/* nothing new and the publisher still around: nothing to do. */
+	if(!s->publishing && !read_frame(s, l) && !take_over(s, l))
+		return 0;
+	if(!s->publishing)
+		return 1;
+
+	mtx_layers_step(l);
+	publish(s, l);
+	return 1;
+}
+
+int shared_publishing(const struct shared *s)
+{
+	return s->publishing;
+}
+
+#else
+
+/* no POSIX shared memory, every process runs its own simulation. */
+struct shared *shared_open(const struct shared_key *key)
+{
+	errno = ENOSYS;
+	return NULL;
+}
+
+void shared_close(struct shared *s)
+{
+}
+
+int shared_step(struct shared *s, struct mtx_layers *l)
+{
+	mtx_layers_step(l);
+	return 1;
+}
+
+int shared_publishing(const struct shared *s)
+{
+	return 1;
+}
+
+#endif
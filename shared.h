@@ -0,0 +1,59 @@
+ /**********************************************************************\
+ | shared.h                                                             |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+/* --shared: processes showing the same rain (same size and mode) share */
+/* one simulation through a POSIX shared memory ring. whoever holds the */
+/* publisher lock steps it and writes every frame into the ring, the */
+/* rest just show the newest frame, and one of them takes over when */
+/* the publisher goes away. segments are per user, as anyone who can */
+/* write one can draw on the terminals reading it. */
+
+#ifndef SHARED_H
+#define SHARED_H
+
+#include <stdint.h>
+
+#include "mtx.h"
+
+/* everything that has to match to show the same rain. */
+struct shared_key
+{
+	int32_t cols, lines;
+	uint32_t flags;             /* MTX_FLAG_ASYNC, OLD, CHANGES and PAUSE. */
+	int32_t layers, randmin, randmax, update;
+};
+
+struct shared;
+
+/* NULL (with errno set) if there's no shared memory to be had. */
+struct shared *shared_open(const struct shared_key *key);
+void shared_close(struct shared *s);
+
+/* one frame of l: stepped and published, or the publisher's newest. */
+/* returns 0 if there was no new frame to show, and l is as it was. */
+int shared_step(struct shared *s, struct mtx_layers *l);
+
+/* whether this process is the one simulating. */
+int shared_publishing(const struct shared *s);
+
+#endif /* SHARED_H */
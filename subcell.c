@@ -0,0 +1,211 @@
+ /**********************************************************************\
+ | subcell.c                                                            |
+ |                                                                      |
+ | Copyright (C) 2025-2026       Xylia Allegretta                       |
+ | Copyright (C) 1999-2002, 2024 Chris Allegretta                       |
+ | Copyright (C) 2017-2019       Abishek V Ashok                        |
+ |                                                                      |
+ | This file is part of cmatrix.                                        |
+ |                                                                      |
+ | cmatrix is free software: you can redistribute it and/or modify      |
+ | it under the terms of the GNU General Public License as published by |
+ | the Free Software Foundation, either version 3 of the License, or    |
+ | (at your option) any later version.                                  |
+ |                                                                      |
+ | cmatrix is distributed in the hope that it will be useful,           |
+ | but WITHOUT ANY WARRANTY; without even the implied warranty of       |
+ | MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the        |
+ | GNU General Public License for more details.                         |
+ |                                                                      |
+ | You should have received a copy of the GNU General Public License    |
+ | along with cmatrix. If not, see <http://www.gnu.org/licenses/>.      |
+ \**********************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mtx.h"
+
+/* pattern bits of the left and right dot in each row of a cell. */
+static const uint8_t braille_left[4] = {0x01, 0x02, 0x04, 0x40};
+static const uint8_t braille_right[4] = {0x08, 0x10, 0x20, 0x80};
+static const uint8_t half_dot[2] = {0x01, 0x02};
+
+/* for every row of a cell and every byte of a plane row, the bits that */
+/* byte sets in each of the 8 / sx cells it covers, one cell per byte of */
+/* the entry in memory order. a cell's pattern is then just the rows' */
+/* entries or'ed together, for 4 or 8 cells at once. */
+static void build_lut(struct mtx_sub *s)
+{
+	uint8_t lanes[8];
+	int k, b, i;
+
+	for(k=0; k<s->sy; k++)
+	{
+		for(b=0; b<256; b++)
+		{
+			memset(lanes, 0, sizeof(lanes));
+			for(i=0; i<8 / s->sx; i++)
+			{
+				if(s->mode == MTX_SUB_BRAILLE)
+				{
+					if(b & (1 << (2 * i)))
+						lanes[i] |= braille_left[k];
+					if(b & (1 << (2 * i + 1)))
+						lanes[i] |= braille_right[k];
+				}
+				else if(b & (1 << i))
+					lanes[i] |= half_dot[k];
+			}
+			memcpy(&s->lut[k][b], lanes, sizeof(lanes));
+		}
+	}
+}
+
+struct mtx_sub *mtx_sub_init(int mode, int cols, int lines)
+{
+	struct mtx_sub *s;
+	size_t plane;
+
+	if((mode != MTX_SUB_BRAILLE && mode != MTX_SUB_HALF) || cols < 1 || lines < 1)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+	if(!(s = calloc(1, sizeof(struct mtx_sub))))
+		return NULL;
+	s->mode = mode;
+	s->cols = cols;
+	s->lines = lines;
+	s->sx = mode == MTX_SUB_BRAILLE ? 2 : 1;
+	s->sy = mode == MTX_SUB_BRAILLE ? 4 : 2;
+	s->bytes = (cols * s->sx + 7) / 8;
+	build_lut(s);
+
+	plane = (size_t) s->bytes * lines * s->sy;
+	s->rain = calloc(plane, 1);
+	s->heads = calloc(plane, 1);
+	s->glyph = calloc((size_t) cols * lines + 8, 1);
+	s->head = calloc((size_t) cols * lines + 8, 1);
+	s->changed = malloc(sizeof(int) * cols * lines);
+	if(!s->rain || !s->heads || !s->glyph || !s->head || !s->changed)
+	{
+		mtx_sub_free(s);
+		errno = ENOMEM;
+		return NULL;
+	}
+	return s;
+}
+
+void mtx_sub_free(struct mtx_sub *s)
+{
+	if(s == NULL)
+		return;
+	free(s->rain);
+	free(s->heads);
+	free(s->glyph);
+	free(s->head);
+	free(s->changed);
+	free(s);
+}
+
+/* the dot at simulation cell y, x (x even) takes the value there. */
+static void set_dot(struct mtx_sub *s, int y, int x, int val)
+{
+	size_t byte = (size_t) y * s->bytes + (x >> 4);
+	uint8_t bit = 1 << ((x >> 1) & 7);
+
+	if(val != MTX_BLANK)
+		s->rain[byte] |= bit;
+	else
+		s->rain[byte] &= ~bit;
+	if(val == MTX_HEAD)
+		s->heads[byte] |= bit;
+	else
+		s->heads[byte] &= ~bit;
+}
+
+void mtx_sub_apply(struct mtx_sub *s, int **matrix, const struct mtx_change *c, size_t n)
+{
+	size_t i;
+
+	for(i=0; i<n; i++)
+		set_dot(s, c[i].y, c[i].x, matrix[c[i].y][c[i].x]);
+}
+
+void mtx_sub_load(struct mtx_sub *s, int **matrix)
+{
+	int y, x;
+
+	for(y=0; y<s->lines * s->sy; y++)
+	{
+		for(x=0; x<s->cols * s->sx * 2; x+=2)
+			set_dot(s, y, x, matrix[y][x]);
+	}
+}
+
+/* 8 bytes from p, in memory order like the table entries. */
+static uint64_t load(const uint8_t *p)
+{
+	uint64_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+void mtx_sub_pack(struct mtx_sub *s)
+{
+	const int per = 8 / s->sx;
+	uint64_t glyphs, heads, mask, full;
+	uint8_t lanes[8], g[8], h[8];
+	const uint8_t *rain, *head;
+	int y, b, k, i, n, cell;
+
+	/* the bytes of an entry that are cells of this byte. */
+	memset(lanes, 0, sizeof(lanes));
+	memset(lanes, 0xFF, per);
+	memcpy(&full, lanes, sizeof(full));
+
+	s->nchanged = 0;
+	for(y=0; y<s->lines; y++)
+	{
+		rain = s->rain + (size_t) y * s->sy * s->bytes;
+		head = s->heads + (size_t) y * s->sy * s->bytes;
+		for(b=0; b<s->bytes; b++)
+		{
+			glyphs = heads = 0;
+			for(k=0; k<s->sy; k++)
+			{
+				glyphs |= s->lut[k][rain[k * s->bytes + b]];
+				heads |= s->lut[k][head[k * s->bytes + b]];
+			}
+
+			/* the usual case, nothing here changed. the arrays are */
+			/* padded, so 8 bytes can always be read. */
+			cell = y * s->cols + b * per;
+			n = s->cols - b * per < per ? s->cols - b * per : per;
+			mask = full;
+			if(n < per)
+			{
+				memset(lanes, 0, sizeof(lanes));
+				memset(lanes, 0xFF, n);
+				memcpy(&mask, lanes, sizeof(mask));
+			}
+			if(!(((load(s->glyph + cell) ^ glyphs) | (load(s->head + cell) ^ heads)) & mask))
+				continue;
+
+			memcpy(g, &glyphs, sizeof(g));
+			memcpy(h, &heads, sizeof(h));
+			for(i=0; i<n; i++)
+			{
+				if(s->glyph[cell + i] != g[i] || s->head[cell + i] != h[i])
+				{
+					s->glyph[cell + i] = g[i];
+					s->head[cell + i] = h[i];
+					s->changed[s->nchanged++] = cell + i;
+				}
+			}
+		}
+	}
+}